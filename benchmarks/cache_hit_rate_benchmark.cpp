@@ -0,0 +1,106 @@
+#include "concurrent_cache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Read-through hit rate of ConcurrentCache's eviction policies on a Zipf
+// trace: get(), and insert() on a miss. Defaults: Zipf(0.9) over 1M keys, a
+// 10k-entry cache, 10M accesses split across 4 threads. Override with
+//   cache_hit_rate_benchmark [skew] [keys] [capacity] [accesses] [threads]
+
+using Cache = ConcurrentCache<uint64_t, uint64_t>;
+
+// Inverse-CDF Zipf sampler: rank r (0-based) has weight 1 / (r + 1)^skew
+class ZipfSampler {
+private:
+    std::vector<double> cdf;
+
+public:
+    ZipfSampler(size_t keys, double skew) : cdf(keys) {
+        double total = 0.0;
+        for (size_t rank = 0; rank < keys; rank++) {
+            total += 1.0 / std::pow(static_cast<double>(rank + 1), skew);
+            cdf[rank] = total;
+        }
+        for (double& value : cdf) {
+            value /= total;
+        }
+    }
+
+    template<typename Rng>
+    uint64_t operator()(Rng& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return static_cast<uint64_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+    }
+};
+
+const char* policy_name(Cache::Policy policy) {
+    switch (policy) {
+        case Cache::Policy::CLOCK:
+            return "CLOCK";
+        case Cache::Policy::S3_FIFO:
+            return "S3-FIFO";
+        case Cache::Policy::W_TINYLFU:
+            return "W-TinyLFU";
+    }
+    return "?";
+}
+
+int main(int argc, char* argv[]) {
+    double skew = argc > 1 ? std::stod(argv[1]) : 0.9;
+    size_t keys = argc > 2 ? std::stoul(argv[2]) : 1000000;
+    size_t capacity = argc > 3 ? std::stoul(argv[3]) : 10000;
+    size_t accesses = argc > 4 ? std::stoul(argv[4]) : 10000000;
+    size_t threads = argc > 5 ? std::stoul(argv[5]) : 4;
+
+    std::cout << "Cache Hit Rate Benchmark\n";
+    std::cout << "========================\n";
+    std::cout << "Zipf(" << skew << ") over " << keys << " keys, " << capacity << " entries, "
+              << accesses << " accesses on " << threads << " threads\n\n";
+
+    ZipfSampler zipf(keys, skew);
+    // Scatter ranks so popular keys do not share shards or buckets
+    auto key_of = [](uint64_t rank) { return rank * 0x9E3779B97F4A7C15ULL; };
+
+    for (Cache::Policy policy : {Cache::Policy::CLOCK, Cache::Policy::S3_FIFO, Cache::Policy::W_TINYLFU}) {
+        Cache::Options options;
+        options.policy = policy;
+        Cache cache(capacity, options);
+
+        std::vector<uint64_t> hits(threads, 0);
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                std::mt19937_64 rng(1234 + t);
+                size_t share = accesses / threads;
+                for (size_t i = 0; i < share; i++) {
+                    uint64_t key = key_of(zipf(rng));
+                    uint64_t value;
+                    if (cache.get(key, value)) {
+                        hits[t]++;
+                    } else {
+                        cache.insert(key, key);
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        uint64_t total_hits = 0;
+        for (uint64_t h : hits) {
+            total_hits += h;
+        }
+        std::cout << std::setw(10) << policy_name(policy) << "  hit rate " << std::fixed
+                  << std::setprecision(3)
+                  << static_cast<double>(total_hits) / static_cast<double>(accesses / threads * threads)
+                  << "\n";
+    }
+    return 0;
+}
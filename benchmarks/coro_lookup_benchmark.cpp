@@ -0,0 +1,63 @@
+#include "lockfree_hashmap.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Single-threaded lookup latency on maps larger than the cache: plain get()
+// loop vs coroutine-interleaved get_async() vs probe_batch()
+
+template<typename F>
+double ns_per_lookup(size_t lookups, F&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / lookups;
+}
+
+void run_lookup_benchmark(size_t entries, size_t lookups) {
+    LockFreeHashMap<uint64_t, uint64_t> map(entries);
+    for (uint64_t i = 0; i < entries; i++) {
+        map.insert(i * 7, i);
+    }
+
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> keys(lookups);
+    for (auto& key : keys) {
+        key = (rng() % entries) * 7;
+    }
+
+    uint64_t sums[3] = {0, 0, 0};
+    double get_ns = ns_per_lookup(lookups, [&] {
+        uint64_t value;
+        for (uint64_t key : keys) {
+            if (map.get(key, value)) {
+                sums[0] += value;
+            }
+        }
+    });
+    double coro_ns = ns_per_lookup(lookups, [&] {
+        interleave_lookups(map, keys.size(), [&](size_t i) { return keys[i]; },
+                           [&](size_t, const uint64_t& value) { sums[1] += value; });
+    });
+    double batch_ns = ns_per_lookup(lookups, [&] {
+        map.probe_batch(keys.size(), [&](size_t i) -> const uint64_t& { return keys[i]; },
+                        [&](size_t, const uint64_t& value) { sums[2] += value; });
+    });
+
+    std::cout << std::setw(10) << entries << " entries: get " << std::fixed << std::setprecision(1)
+              << get_ns << " ns, get_async x" << INTERLEAVED_LOOKUPS << " " << coro_ns
+              << " ns, probe_batch " << batch_ns << " ns"
+              << (sums[0] == sums[1] && sums[0] == sums[2] ? "" : "  (MISMATCH)") << "\n";
+}
+
+int main() {
+    std::cout << "Coroutine-Interleaved Lookup Benchmark\n";
+    std::cout << "======================================\n";
+    for (size_t entries : {size_t{1} << 16, size_t{1} << 20, size_t{1} << 23}) {
+        run_lookup_benchmark(entries, 1 << 21);
+    }
+    return 0;
+}
@@ -0,0 +1,515 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "frequency_sketch.hpp"
+#include "hazard_pointer.hpp"
+#include "parallel.hpp"
+
+// Bounded cache: a capacity in entries, or in any other unit through a
+// weigher (e.g. bytes), with scan-resistant eviction. Unlike LockFreeHashMap,
+// evicted and removed entries are freed while the cache is in use.
+//
+// The cache is split into shards, each with its own chained index, eviction
+// queues and a mutex taken only by insert/remove/eviction. get() takes no lock:
+// it walks the chain under hazard pointers and, on a hit, bumps the entry's
+// small frequency counter with a relaxed store - and only while the counter is
+// below its cap, so hot entries are read without writing to shared memory.
+//
+// Policies (both approximate LRU without a global list):
+//   CLOCK   - one FIFO with second chance: a referenced entry at the tail gets
+//             its bit cleared and is reinserted, an unreferenced one is evicted
+//   S3_FIFO - new entries enter a small FIFO (10% of capacity); entries hit
+//             there move to the main FIFO (CLOCK with a 2-bit counter), the rest
+//             are evicted and remembered in a ghost FIFO of key hashes so a quick
+//             re-insert goes straight to main. One-hit wonders and scans never
+//             reach main
+//   W_TINYLFU - new entries enter a window FIFO (1% of capacity); when it
+//             overflows, its oldest entry replaces main's CLOCK victim only if
+//             a TinyLFU sketch (frequency_sketch.hpp) has seen it more often.
+//             Every get(), hit or miss, records the key in the shard's sketch
+//
+// A shard that overflows evicts a batch, down to 1/64 below its capacity, and
+// retires the victims after dropping the lock. At most 128 threads may access
+// caches of the same K/V types at the same time (hazard pointer slots are
+// recycled when a thread exits); one more gets std::runtime_error
+template<typename K, typename V>
+class ConcurrentCache {
+public:
+    enum class Policy {
+        CLOCK,
+        S3_FIFO,
+        W_TINYLFU
+    };
+
+    struct Options {
+        Policy policy = Policy::S3_FIFO;
+        // Cost of one entry against the capacity; unset means 1 per entry
+        std::function<size_t(const K&, const V&)> weigher;
+        // Sizes the index; 0 means the capacity (or 65536 with a weigher)
+        size_t expected_entries = 0;
+        // 0 picks a power of two from the hardware concurrency
+        size_t shards = 0;
+    };
+
+private:
+    static constexpr size_t MIN_SHARD_BUCKETS = 16;
+    static constexpr size_t EVICTION_SLACK_DIVISOR = 64;
+    static constexpr uintptr_t UNLINKED = 1; // Low bit of Node::next: node left the index
+
+    enum class Queue : uint8_t {
+        SMALL,
+        MAIN
+    };
+
+    struct Node {
+        K key;
+        V value;
+        uint64_t hash;
+        size_t charge;
+        std::atomic<uintptr_t> next{0};       // Index chain
+        std::atomic<uint8_t> frequency{0};    // Set by readers, cleared by eviction
+
+        // Eviction queue links, guarded by the shard lock
+        Queue queue = Queue::MAIN;
+        Node* newer = nullptr;
+        Node* older = nullptr;
+
+        Node(const K& k, const V& v, uint64_t h, size_t c) : key(k), value(v), hash(h), charge(c) {}
+    };
+
+    // Intrusive FIFO: push at the head, evict from the tail
+    struct Fifo {
+        Node* head = nullptr;
+        Node* tail = nullptr;
+        size_t charge = 0;
+
+        void push(Node* node) {
+            node->older = head;
+            node->newer = nullptr;
+            if (head != nullptr) {
+                head->newer = node;
+            } else {
+                tail = node;
+            }
+            head = node;
+            charge += node->charge;
+        }
+
+        void erase(Node* node) {
+            (node->newer != nullptr ? node->newer->older : head) = node->older;
+            (node->older != nullptr ? node->older->newer : tail) = node->newer;
+            charge -= node->charge;
+        }
+
+        bool empty() const {
+            return tail == nullptr;
+        }
+    };
+
+    struct alignas(64) Shard {
+        std::mutex lock;
+        std::unique_ptr<std::atomic<uintptr_t>[]> buckets;
+        size_t capacity = 0;
+        size_t small_capacity = 0;
+        size_t entries = 0;
+        Fifo small;
+        Fifo main;
+        std::unordered_set<uint64_t> ghost;
+        std::deque<uint64_t> ghost_order;
+        std::unique_ptr<FrequencySketch> sketch; // W_TINYLFU only
+    };
+
+    Options options;
+    uint8_t max_frequency;
+    size_t shard_mask;
+    size_t shard_bits;
+    size_t bucket_mask;
+    std::unique_ptr<Shard[]> shards;
+    std::hash<K> hasher;
+    mutable HazardPointerManager<Node> hazard_pointers;
+    std::atomic<uint64_t> eviction_count{0};
+
+    static size_t round_up_pow2(size_t n) {
+        size_t result = 1;
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static Node* pointer(uintptr_t link) {
+        return reinterpret_cast<Node*>(link & ~UNLINKED);
+    }
+
+    uint64_t hash_of(const K& key) const {
+        uint64_t h = hasher(key);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    Shard& shard_of(uint64_t hash) const {
+        return shards[hash & shard_mask];
+    }
+
+    std::atomic<uintptr_t>& bucket_of(Shard& shard, uint64_t hash) const {
+        return shard.buckets[(hash >> shard_bits) & bucket_mask];
+    }
+
+    // Link in the shard's index that points at key's node (or ends the chain);
+    // shard lock held
+    std::atomic<uintptr_t>* find_link(Shard& shard, const K& key, uint64_t hash) const {
+        std::atomic<uintptr_t>* link = &bucket_of(shard, hash);
+        Node* node;
+        while ((node = pointer(link->load(std::memory_order_relaxed))) != nullptr) {
+            if (node->hash == hash && node->key == key) {
+                break;
+            }
+            link = &node->next;
+        }
+        return link;
+    }
+
+    // Walk a chain hand over hand with the two hazard slots and return key's
+    // node, still protected, or nullptr. Restarts from the bucket whenever the
+    // node it stands on leaves the index
+    Node* find_protected(const std::atomic<uintptr_t>& bucket, const K& key, uint64_t hash) const {
+        while (true) {
+            const std::atomic<uintptr_t>* link = &bucket;
+            uintptr_t current = link->load(std::memory_order_acquire);
+            size_t slot = 0;
+
+            while (true) {
+                Node* node = pointer(current);
+                if (node == nullptr) {
+                    return nullptr;
+                }
+                // Publish the hazard, then confirm the node is still reachable
+                hazard_pointers.acquire(slot, node);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (link->load(std::memory_order_acquire) != current) {
+                    break;
+                }
+                if (node->hash == hash && node->key == key) {
+                    return node;
+                }
+                link = &node->next;
+                current = link->load(std::memory_order_acquire);
+                if ((current & UNLINKED) != 0) {
+                    break;
+                }
+                slot ^= 1;
+            }
+        }
+    }
+
+    // Take node out of the index and its queue; shard lock held. Readers still
+    // on the node see the UNLINKED bit and restart from the bucket
+    void unlink(Shard& shard, std::atomic<uintptr_t>& link, Node* node) {
+        uintptr_t next = node->next.load(std::memory_order_relaxed);
+        link.store(next, std::memory_order_release);
+        node->next.store(next | UNLINKED, std::memory_order_release);
+        (node->queue == Queue::SMALL ? shard.small : shard.main).erase(node);
+        shard.entries--;
+    }
+
+    void remember_ghost(Shard& shard, uint64_t hash) {
+        if (shard.ghost.insert(hash).second) {
+            shard.ghost_order.push_back(hash);
+        }
+        // About as many ghosts as live entries, as in the S3-FIFO paper
+        while (shard.ghost_order.size() > shard.entries + 1) {
+            shard.ghost.erase(shard.ghost_order.front());
+            shard.ghost_order.pop_front();
+        }
+    }
+
+    // Main's tail once referenced entries have had their second chance
+    Node* main_victim(Shard& shard) {
+        Node* tail;
+        while ((tail = shard.main.tail) != nullptr) {
+            uint8_t frequency = tail->frequency.load(std::memory_order_relaxed);
+            if (frequency == 0) {
+                break;
+            }
+            shard.main.erase(tail);
+            tail->frequency.store(frequency - 1, std::memory_order_relaxed);
+            shard.main.push(tail);
+        }
+        return tail;
+    }
+
+    void promote(Shard& shard, Node* node) {
+        shard.small.erase(node);
+        node->frequency.store(0, std::memory_order_relaxed);
+        node->queue = Queue::MAIN;
+        shard.main.push(node);
+    }
+
+    // Pick the next victim, promoting or aging entries on the way; shard lock held
+    Node* next_victim(Shard& shard) {
+        while (true) {
+            Node* candidate = shard.small.tail;
+            if (options.policy == Policy::W_TINYLFU) {
+                // Main entries only leave by losing an admission contest, unless
+                // an empty window leaves the shard over capacity
+                if (candidate == nullptr) {
+                    return charge_of(shard) > shard.capacity ? main_victim(shard) : nullptr;
+                }
+            } else if (candidate == nullptr ||
+                       (shard.small.charge <= shard.small_capacity && !shard.main.empty())) {
+                return main_victim(shard);
+            }
+
+            if (options.policy == Policy::S3_FIFO) {
+                if (candidate->frequency.load(std::memory_order_relaxed) == 0) {
+                    remember_ghost(shard, candidate->hash);
+                    return candidate;
+                }
+                promote(shard, candidate);
+                continue;
+            }
+
+            // W_TINYLFU admission: the window's oldest entry against main's victim
+            Node* victim = main_victim(shard);
+            if (victim == nullptr ||
+                shard.main.charge + candidate->charge <= shard.capacity - shard.small_capacity) {
+                promote(shard, candidate);
+                continue;
+            }
+            if (shard.sketch->estimate(candidate->hash) > shard.sketch->estimate(victim->hash)) {
+                promote(shard, candidate);
+                return victim;
+            }
+            return candidate;
+        }
+    }
+
+    size_t charge_of(Shard& shard) const {
+        return shard.small.charge + shard.main.charge;
+    }
+
+    // Evict until the shard is 1/64 below capacity; shard lock held
+    void evict(Shard& shard, std::vector<Node*>& victims) {
+        if (charge_of(shard) <= shard.capacity) {
+            return;
+        }
+        size_t target = shard.capacity - shard.capacity / EVICTION_SLACK_DIVISOR;
+        while (charge_of(shard) > target) {
+            Node* victim = next_victim(shard);
+            if (victim == nullptr) {
+                break;
+            }
+            unlink(shard, *find_link(shard, victim->key, victim->hash), victim);
+            victims.push_back(victim);
+        }
+    }
+
+    // Called after the shard lock is dropped
+    void retire(std::vector<Node*>& nodes, bool evicted) {
+        if (nodes.empty()) {
+            return;
+        }
+        // Orders the unlinks before the reclaimer's hazard scan
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (Node* node : nodes) {
+            hazard_pointers.retire(node);
+        }
+        if (evicted) {
+            eviction_count.fetch_add(nodes.size(), std::memory_order_relaxed);
+        }
+    }
+
+public:
+    explicit ConcurrentCache(size_t capacity, Options opts = Options()) : options(std::move(opts)) {
+        if (capacity == 0) {
+            throw std::invalid_argument("ConcurrentCache capacity must be positive");
+        }
+        max_frequency = options.policy == Policy::S3_FIFO ? 3 : 1;
+
+        // Several shards per core, but keep each big enough to hold a batch
+        size_t shard_count = options.shards != 0 ? round_up_pow2(options.shards)
+                                                 : round_up_pow2(4 * default_parallelism());
+        if (options.shards == 0) {
+            while (shard_count > 1 && capacity / shard_count < EVICTION_SLACK_DIVISOR) {
+                shard_count >>= 1;
+            }
+        }
+        shard_mask = shard_count - 1;
+        shard_bits = 0;
+        while ((size_t{1} << shard_bits) < shard_count) {
+            shard_bits++;
+        }
+
+        size_t expected = options.expected_entries != 0 ? options.expected_entries
+                          : options.weigher ? size_t{1} << 16 : capacity;
+        size_t shard_buckets = round_up_pow2(expected / shard_count);
+        if (shard_buckets < MIN_SHARD_BUCKETS) {
+            shard_buckets = MIN_SHARD_BUCKETS;
+        }
+        bucket_mask = shard_buckets - 1;
+
+        shards.reset(new Shard[shard_count]);
+        for (size_t i = 0; i < shard_count; i++) {
+            Shard& shard = shards[i];
+            shard.capacity = capacity / shard_count + (i < capacity % shard_count ? 1 : 0);
+            if (options.policy == Policy::W_TINYLFU) {
+                shard.small_capacity = shard.capacity / 100;
+                shard.sketch.reset(new FrequencySketch(shard_buckets));
+            } else {
+                shard.small_capacity = shard.capacity / 10;
+            }
+            shard.buckets.reset(new std::atomic<uintptr_t>[shard_buckets]);
+            for (size_t b = 0; b < shard_buckets; b++) {
+                shard.buckets[b].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    ~ConcurrentCache() {
+        for (size_t i = 0; i <= shard_mask; i++) {
+            for (size_t b = 0; b <= bucket_mask; b++) {
+                Node* node = pointer(shards[i].buckets[b].load(std::memory_order_relaxed));
+                while (node != nullptr) {
+                    Node* next = pointer(node->next.load(std::memory_order_relaxed));
+                    delete node;
+                    node = next;
+                }
+            }
+        }
+        hazard_pointers.reclaim_all();
+    }
+
+    ConcurrentCache(const ConcurrentCache&) = delete;
+    ConcurrentCache& operator=(const ConcurrentCache&) = delete;
+
+    // Insert or replace key, evicting as needed. Returns false when the entry
+    // alone outweighs its shard's capacity; key is then left uncached, so a
+    // previous value is removed rather than served stale
+    bool insert(const K& key, const V& value) {
+        uint64_t hash = hash_of(key);
+        size_t charge = options.weigher ? options.weigher(key, value) : 1;
+        Shard& shard = shard_of(hash);
+        if (charge > shard.capacity) {
+            remove(key);
+            return false;
+        }
+
+        Node* node = new Node(key, value, hash, charge);
+        std::vector<Node*> replaced;
+        std::vector<Node*> victims;
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            std::atomic<uintptr_t>* link = find_link(shard, key, hash);
+            Node* old = pointer(link->load(std::memory_order_relaxed));
+            if (old != nullptr) {
+                // Replace: the new node inherits the old one's queue and access
+                // frequency but is pushed at the tail of that queue, like a fresh
+                // insert, after the old node is unlinked
+                node->frequency.store(old->frequency.load(std::memory_order_relaxed),
+                                      std::memory_order_relaxed);
+                node->queue = old->queue;
+                unlink(shard, *link, old);
+                replaced.push_back(old);
+            } else if (options.policy == Policy::S3_FIFO) {
+                node->queue = shard.ghost.erase(hash) != 0 ? Queue::MAIN : Queue::SMALL;
+            } else if (options.policy == Policy::W_TINYLFU) {
+                node->queue = Queue::SMALL;
+            }
+
+            std::atomic<uintptr_t>& bucket = bucket_of(shard, hash);
+            node->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            bucket.store(reinterpret_cast<uintptr_t>(node), std::memory_order_release);
+            (node->queue == Queue::SMALL ? shard.small : shard.main).push(node);
+            shard.entries++;
+
+            evict(shard, victims);
+        }
+        retire(replaced, false);
+        retire(victims, true);
+        return true;
+    }
+
+    // Lock-free; a hit marks the entry as recently used
+    bool get(const K& key, V& value) const {
+        uint64_t hash = hash_of(key);
+        Shard& shard = shard_of(hash);
+        if (shard.sketch) {
+            shard.sketch->increment(hash); // Misses too: they are the next candidates
+        }
+        Node* node = find_protected(bucket_of(shard, hash), key, hash);
+        if (node != nullptr) {
+            value = node->value;
+            uint8_t frequency = node->frequency.load(std::memory_order_relaxed);
+            if (frequency < max_frequency) {
+                node->frequency.store(frequency + 1, std::memory_order_relaxed);
+            }
+        }
+        hazard_pointers.release(0);
+        hazard_pointers.release(1);
+        return node != nullptr;
+    }
+
+    bool remove(const K& key) {
+        uint64_t hash = hash_of(key);
+        Shard& shard = shard_of(hash);
+        std::vector<Node*> removed;
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            std::atomic<uintptr_t>* link = find_link(shard, key, hash);
+            Node* node = pointer(link->load(std::memory_order_relaxed));
+            if (node == nullptr) {
+                return false;
+            }
+            unlink(shard, *link, node);
+            removed.push_back(node);
+        }
+        retire(removed, false);
+        return true;
+    }
+
+    // Entries currently cached (weakly consistent while writers run)
+    size_t size() const {
+        size_t total = 0;
+        for (size_t i = 0; i <= shard_mask; i++) {
+            std::lock_guard<std::mutex> guard(shards[i].lock);
+            total += shards[i].entries;
+        }
+        return total;
+    }
+
+    // Sum of the cached entries' weights
+    size_t charge() const {
+        size_t total = 0;
+        for (size_t i = 0; i <= shard_mask; i++) {
+            std::lock_guard<std::mutex> guard(shards[i].lock);
+            total += charge_of(shards[i]);
+        }
+        return total;
+    }
+
+    uint64_t evictions() const {
+        return eviction_count.load(std::memory_order_relaxed);
+    }
+
+    size_t shard_count() const {
+        return shard_mask + 1;
+    }
+
+    const HazardPointerManager<Node>& reclaimer() const {
+        return hazard_pointers;
+    }
+};
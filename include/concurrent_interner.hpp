@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+
+#include "lockfree_hashmap.hpp"
+
+// Interns strings as dense 32-bit ids (0, 1, 2, ... in first-intern order) and
+// maps ids back to the strings.
+//
+// String bytes are copied once into an append-only arena of large chunks
+// (bump allocation with one fetch_add), and the index is a LockFreeHashMap
+// keyed by string_views into that arena, so interning a new string costs one
+// map node and no per-string heap allocation. Interning a known string is a
+// plain lock-free get(). A new string is linked with get_or_compute(): the
+// thread whose node wins assigns the next id, and concurrent interners of the
+// same string wait only for that id to be stored. A thread that loses the race
+// leaves its copy of the bytes unused in the arena.
+//
+// id -> string is a segmented array whose segments double in size and are
+// installed with a CAS, so it grows without locks or copying. Strings and ids
+// stay valid for the interner's lifetime
+class ConcurrentInterner {
+private:
+    static constexpr size_t CHUNK_BYTES = 1 << 20;
+    static constexpr size_t FIRST_SEGMENT_BITS = 10;
+    static constexpr size_t SEGMENTS = 33 - FIRST_SEGMENT_BITS; // Covers every 32-bit id
+
+    struct Chunk {
+        Chunk* previous;
+        size_t capacity;
+        std::atomic<size_t> used;
+
+        char* data() {
+            return reinterpret_cast<char*>(this + 1);
+        }
+    };
+
+    LockFreeHashMap<std::string_view, uint32_t> index;
+    std::atomic<uint32_t> next_id{0};
+    std::atomic<std::string_view*> segments[SEGMENTS];
+
+    std::atomic<Chunk*> current_chunk{nullptr}; // Bump allocation happens here
+    std::atomic<Chunk*> retired_chunks{nullptr}; // Full chunks and oversized strings
+    std::atomic<size_t> chunk_bytes{0};
+
+    Chunk* new_chunk(size_t capacity) {
+        void* memory = ::operator new(sizeof(Chunk) + capacity);
+        Chunk* chunk = static_cast<Chunk*>(memory);
+        chunk->previous = nullptr;
+        chunk->capacity = capacity;
+        new (&chunk->used) std::atomic<size_t>(0);
+        chunk_bytes.fetch_add(capacity, std::memory_order_relaxed);
+        return chunk;
+    }
+
+    static void free_chunk(Chunk* chunk) {
+        chunk->used.~atomic();
+        ::operator delete(chunk);
+    }
+
+    void push_retired(Chunk* chunk) {
+        Chunk* head = retired_chunks.load(std::memory_order_relaxed);
+        do {
+            chunk->previous = head;
+        } while (!retired_chunks.compare_exchange_weak(head, chunk,
+                                                       std::memory_order_release,
+                                                       std::memory_order_relaxed));
+    }
+
+    // Copy bytes into the arena
+    std::string_view store(std::string_view text) {
+        if (text.size() > CHUNK_BYTES / 4) {
+            Chunk* chunk = new_chunk(text.size());
+            std::memcpy(chunk->data(), text.data(), text.size());
+            push_retired(chunk);
+            return std::string_view(chunk->data(), text.size());
+        }
+
+        while (true) {
+            Chunk* chunk = current_chunk.load(std::memory_order_acquire);
+            if (chunk != nullptr) {
+                size_t offset = chunk->used.fetch_add(text.size(), std::memory_order_relaxed);
+                if (offset + text.size() <= chunk->capacity) {
+                    std::memcpy(chunk->data() + offset, text.data(), text.size());
+                    return std::string_view(chunk->data() + offset, text.size());
+                }
+            }
+            // Chunk full (or none yet): install a fresh one; losers free theirs
+            Chunk* fresh = new_chunk(CHUNK_BYTES);
+            if (current_chunk.compare_exchange_strong(chunk, fresh,
+                                                      std::memory_order_acq_rel,
+                                                      std::memory_order_acquire)) {
+                if (chunk != nullptr) {
+                    push_retired(chunk);
+                }
+            } else {
+                chunk_bytes.fetch_sub(CHUNK_BYTES, std::memory_order_relaxed);
+                free_chunk(fresh);
+            }
+        }
+    }
+
+    // Segment s holds ids [2^(s+B) - 2^B, 2^(s+B+1) - 2^B) for B = FIRST_SEGMENT_BITS
+    static void locate(uint32_t id, size_t& segment, size_t& offset) {
+        uint64_t adjusted = static_cast<uint64_t>(id) + (uint64_t{1} << FIRST_SEGMENT_BITS);
+        size_t bit = 63 - static_cast<size_t>(__builtin_clzll(adjusted));
+        segment = bit - FIRST_SEGMENT_BITS;
+        offset = static_cast<size_t>(adjusted - (uint64_t{1} << bit));
+    }
+
+    std::string_view* segment_for(size_t segment) {
+        std::string_view* entries = segments[segment].load(std::memory_order_acquire);
+        if (entries != nullptr) {
+            return entries;
+        }
+        std::string_view* fresh = new std::string_view[size_t{1} << (segment + FIRST_SEGMENT_BITS)];
+        if (segments[segment].compare_exchange_strong(entries, fresh,
+                                                      std::memory_order_acq_rel,
+                                                      std::memory_order_acquire)) {
+            return fresh;
+        }
+        delete[] fresh;
+        return entries;
+    }
+
+public:
+    // expected_strings sizes the index (it keeps working past it, with longer chains)
+    explicit ConcurrentInterner(size_t expected_strings = 1 << 16)
+        : index(expected_strings == 0 ? 1 : expected_strings) {
+        for (auto& segment : segments) {
+            segment.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~ConcurrentInterner() {
+        for (auto& segment : segments) {
+            delete[] segment.load(std::memory_order_relaxed);
+        }
+        Chunk* chunk = current_chunk.load(std::memory_order_relaxed);
+        if (chunk != nullptr) {
+            free_chunk(chunk);
+        }
+        chunk = retired_chunks.load(std::memory_order_relaxed);
+        while (chunk != nullptr) {
+            Chunk* previous = chunk->previous;
+            free_chunk(chunk);
+            chunk = previous;
+        }
+    }
+
+    ConcurrentInterner(const ConcurrentInterner&) = delete;
+    ConcurrentInterner& operator=(const ConcurrentInterner&) = delete;
+
+    // Id of text, assigning the next id if it has not been seen before.
+    // Throws std::overflow_error once all 2^32 - 1 ids are taken
+    uint32_t intern(std::string_view text) {
+        uint32_t id;
+        if (index.get(text, id)) {
+            return id;
+        }
+        std::string_view stored = store(text);
+        return index.get_or_compute(stored, [&] {
+            uint32_t assigned = next_id.fetch_add(1, std::memory_order_relaxed);
+            if (assigned == UINT32_MAX) {
+                next_id.store(UINT32_MAX, std::memory_order_relaxed);
+                throw std::overflow_error("ConcurrentInterner ran out of 32-bit ids");
+            }
+            size_t segment;
+            size_t offset;
+            locate(assigned, segment, offset);
+            segment_for(segment)[offset] = stored;
+            return assigned;
+        });
+    }
+
+    // Id of text without interning it
+    bool find(std::string_view text, uint32_t& id) const {
+        return index.get(text, id);
+    }
+
+    // String of an id returned by intern(); the view stays valid for the
+    // interner's lifetime. Throws std::out_of_range for ids never assigned
+    std::string_view lookup(uint32_t id) const {
+        if (id >= next_id.load(std::memory_order_acquire)) {
+            throw std::out_of_range("ConcurrentInterner id out of range");
+        }
+        size_t segment;
+        size_t offset;
+        locate(id, segment, offset);
+        std::string_view* entries = segments[segment].load(std::memory_order_acquire);
+        if (entries == nullptr) {
+            throw std::out_of_range("ConcurrentInterner id out of range");
+        }
+        return entries[offset];
+    }
+
+    // Ids assigned so far (ids are 0 .. size() - 1)
+    size_t size() const {
+        return next_id.load(std::memory_order_relaxed);
+    }
+
+    // Bytes held by the string arena, including unused chunk tails
+    size_t arena_bytes() const {
+        return chunk_bytes.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,222 @@
+#pragma once
+
+// Coroutine-interleaved lookups (C++20 only; empty under older standards)
+//
+// LockFreeHashMap::get_async(key) returns a LookupTask: a coroutine that
+// prefetches the bucket slot and suspends as soon as it is created, and on
+// each resume reads what it prefetched, prefetches the next node and suspends
+// again. A caller that keeps
+// several tasks in flight and resumes them round-robin overlaps their cache
+// misses, so a batch of lookups into a map much larger than the cache costs
+// roughly one memory latency per group instead of one per node.
+// interleave_lookups() is such a scheduler; a coroutine runtime can equally
+// resume tasks from its own loop.
+//
+// Frames are recycled through a small per-thread cache, so a lookup does not
+// allocate in steady state
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define LOCKFREE_HASHMAP_HAS_COROUTINES 1
+
+#include <coroutine>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Per-thread free list of coroutine frames of one size per promise type
+template<typename Promise>
+class CoroutineFrameCache {
+private:
+    static constexpr size_t MAX_CACHED = 256;
+
+    struct Cache {
+        size_t frame_size = 0;
+        std::vector<void*> frames;
+
+        ~Cache() {
+            for (void* frame : frames) {
+                ::operator delete(frame);
+            }
+        }
+    };
+
+    static Cache& cache() {
+        thread_local Cache instance;
+        return instance;
+    }
+
+public:
+    static void* allocate(size_t size) {
+        Cache& local = cache();
+        if (size == local.frame_size && !local.frames.empty()) {
+            void* frame = local.frames.back();
+            local.frames.pop_back();
+            return frame;
+        }
+        if (local.frame_size == 0) {
+            local.frame_size = size;
+        }
+        return ::operator new(size);
+    }
+
+    static void release(void* frame, size_t size) {
+        Cache& local = cache();
+        if (size == local.frame_size && local.frames.size() < MAX_CACHED) {
+            local.frames.push_back(frame);
+        } else {
+            ::operator delete(frame);
+        }
+    }
+};
+
+// One in-flight lookup. Runs to its first prefetch when created; resume()
+// until done(), then read result(). Move-only; destroying it destroys the coroutine
+template<typename V>
+class LookupTask {
+public:
+    struct promise_type {
+        std::optional<V> result;
+
+        static void* operator new(size_t size) {
+            return CoroutineFrameCache<promise_type>::allocate(size);
+        }
+
+        static void operator delete(void* frame, size_t size) {
+            CoroutineFrameCache<promise_type>::release(frame, size);
+        }
+
+        LookupTask get_return_object() {
+            return LookupTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        void return_value(std::optional<V> value) {
+            result = std::move(value);
+        }
+
+        void unhandled_exception() {
+            throw;
+        }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit LookupTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+public:
+    LookupTask() : handle(nullptr) {}
+
+    LookupTask(LookupTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    LookupTask& operator=(LookupTask&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~LookupTask() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    LookupTask(const LookupTask&) = delete;
+    LookupTask& operator=(const LookupTask&) = delete;
+
+    bool valid() const {
+        return static_cast<bool>(handle);
+    }
+
+    bool done() const {
+        return handle.done();
+    }
+
+    // Run to the next memory access (or to completion)
+    void resume() {
+        handle.resume();
+    }
+
+    // The value found, or nullopt for a missing key. Only after done()
+    const std::optional<V>& result() const {
+        return handle.promise().result;
+    }
+};
+
+// co_await target: prefetch an address and give control back to the resumer
+struct PrefetchAwaiter {
+    const void* address;
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<>) const noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#endif
+    }
+
+    void await_resume() const noexcept {}
+};
+
+// Keys in flight per interleave_lookups() call by default
+constexpr size_t INTERLEAVED_LOOKUPS = 16;
+
+// Look up key_of(i) for i in [0, count) with up to `width` lookups in flight,
+// resuming them round-robin. Calls fn(i, value) for each hit as it completes
+// (out of order); misses are skipped
+template<typename Map, typename KeyOf, typename F>
+void interleave_lookups(const Map& map, size_t count, KeyOf&& key_of, F&& fn,
+                        size_t width = INTERLEAVED_LOOKUPS) {
+    using Task = decltype(map.get_async(key_of(size_t{0})));
+    if (width == 0) {
+        width = 1;
+    }
+    std::vector<Task> tasks(width);
+    std::vector<size_t> positions(width);
+    size_t next = 0;
+    size_t active = 0;
+
+    for (size_t slot = 0; slot < width && next < count; slot++, next++, active++) {
+        tasks[slot] = map.get_async(key_of(next));
+        positions[slot] = next;
+    }
+    while (active != 0) {
+        for (size_t slot = 0; slot < width; slot++) {
+            Task& task = tasks[slot];
+            if (!task.valid()) {
+                continue;
+            }
+            task.resume();
+            if (!task.done()) {
+                continue;
+            }
+            if (task.result()) {
+                fn(positions[slot], *task.result());
+            }
+            if (next < count) {
+                task = map.get_async(key_of(next));
+                positions[slot] = next++;
+            } else {
+                task = Task();
+                active--;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "lockfree_hashmap.hpp"
+#include "parallel.hpp"
+
+// Parallel bulk loading of delimited text (CSV/TSV) into a LockFreeHashMap
+//
+// The file is memory-mapped and cut into newline-aligned chunks that workers
+// claim from a shared cursor. Workers find line ends and delimiters with a
+// vector byte scan, pick the key and value columns out of each line, and hand
+// rows to LockFreeHashMap::insert_batch() in batches. Fields are split on
+// every delimiter byte: quoting and escaped delimiters are not supported.
+// A trailing '\r' (CRLF files) is dropped from each line
+
+// Read-only mapping of a whole file. Throws std::runtime_error on failure
+class MappedFile {
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("cannot stat " + path + ": " + std::strerror(error));
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length != 0) {
+            void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                int error = errno;
+                ::close(fd);
+                throw std::runtime_error("cannot map " + path + ": " + std::strerror(error));
+            }
+            // Chunks are read front to back by several workers at once
+            ::madvise(mapped, length, MADV_WILLNEED);
+            bytes = static_cast<const char*>(mapped);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (bytes != nullptr) {
+            ::munmap(const_cast<char*>(bytes), length);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+};
+
+// First occurrence of byte in [first, last), or last. Compares 32 (AVX2) or
+// 16 (SSE2) bytes per step
+inline const char* find_byte(const char* first, const char* last, char byte) {
+#if defined(__AVX2__)
+    const __m256i wide_needle = _mm256_set1_epi8(byte);
+    while (last - first >= 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wide_needle)));
+        if (mask != 0) {
+            return first + __builtin_ctz(mask);
+        }
+        first += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i needle = _mm_set1_epi8(byte);
+    while (last - first >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        if (mask != 0) {
+            return first + __builtin_ctz(mask);
+        }
+        first += 16;
+    }
+#endif
+    if (first == last) {
+        return last; // An empty file maps to nullptr, which memchr must not see
+    }
+    const void* hit = std::memchr(first, byte, static_cast<size_t>(last - first));
+    return hit != nullptr ? static_cast<const char*>(hit) : last;
+}
+
+struct IngestOptions {
+    char delimiter = ',';
+    size_t key_column = 0;
+    size_t value_column = 1;
+    bool skip_header = false;
+    size_t threads = 0;     // 0: one worker per hardware thread
+};
+
+struct IngestStats {
+    uint64_t rows = 0;      // Rows inserted
+    uint64_t skipped = 0;   // Blank lines, short rows and rows convert() rejected
+    size_t threads = 0;     // Workers actually run (at most one per chunk)
+};
+
+// Chunks per worker, so a slow chunk does not leave the others idle
+constexpr size_t INGEST_CHUNKS_PER_WORKER = 8;
+constexpr size_t INGEST_MIN_CHUNK_BYTES = 1 << 20;
+// Rows a worker collects before one insert_batch()
+constexpr size_t INGEST_BATCH_ROWS = 4096;
+
+// Rough row count from the average line length of the first megabyte, for
+// sizing the map before ingest_delimited()
+inline size_t estimate_row_count(const MappedFile& file) {
+    if (file.size() == 0) {
+        return 1;
+    }
+    const char* begin = file.data();
+    const char* sample_end = begin + std::min<size_t>(file.size(), INGEST_MIN_CHUNK_BYTES);
+    size_t lines = 0;
+    for (const char* p = begin; (p = find_byte(p, sample_end, '\n')) != sample_end; p++) {
+        lines++;
+    }
+    if (lines == 0) {
+        return 1;
+    }
+    return std::max<size_t>(1, file.size() / (static_cast<size_t>(sample_end - begin) / lines));
+}
+
+// Insert the key and value columns of every line of file into map.
+// convert(key_field, value_field, key, value) builds the entry and returns
+// false to skip the row; its exceptions propagate after all workers stop
+template<typename K, typename V, typename Convert>
+IngestStats ingest_delimited(const MappedFile& file, LockFreeHashMap<K, V>& map,
+                             const IngestOptions& options, Convert convert) {
+    IngestStats stats;
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+    if (options.skip_header && begin != end) {
+        begin = std::min(end, find_byte(begin, end, '\n') + 1);
+    }
+    if (begin == end) {
+        return stats;
+    }
+
+    size_t threads = options.threads != 0 ? options.threads : default_parallelism();
+    size_t bytes = static_cast<size_t>(end - begin);
+    size_t chunk_count = std::max<size_t>(
+        1, std::min(threads * INGEST_CHUNKS_PER_WORKER, bytes / INGEST_MIN_CHUNK_BYTES));
+    threads = std::min(threads, chunk_count);
+    stats.threads = threads;
+
+    // Chunk i covers [bounds[i], bounds[i + 1]); every bound but the first
+    // sits just past a newline
+    std::vector<const char*> bounds(chunk_count + 1);
+    bounds[0] = begin;
+    bounds[chunk_count] = end;
+    for (size_t i = 1; i < chunk_count; i++) {
+        const char* nominal = std::max(bounds[i - 1], begin + bytes * i / chunk_count);
+        bounds[i] = std::min(end, find_byte(nominal, end, '\n') + 1);
+    }
+
+    size_t needed = std::max(options.key_column, options.value_column) + 1;
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<uint64_t> rows{0};
+    std::atomic<uint64_t> skipped{0};
+
+    run_parallel(threads, [&](size_t) {
+        std::vector<std::pair<K, V>> batch;
+        batch.reserve(INGEST_BATCH_ROWS);
+        Convert worker_convert = convert;
+        uint64_t worker_rows = 0;
+        uint64_t worker_skipped = 0;
+        std::string_view fields[2];
+        K key{};
+        V value{};
+
+        for (size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+             chunk < chunk_count;
+             chunk = next_chunk.fetch_add(1, std::memory_order_relaxed)) {
+            const char* line = bounds[chunk];
+            const char* chunk_end = bounds[chunk + 1];
+            while (line < chunk_end) {
+                const char* newline = find_byte(line, chunk_end, '\n');
+                const char* line_end = newline;
+                if (line_end != line && line_end[-1] == '\r') {
+                    line_end--;
+                }
+
+                // Walk only as many fields as the key and value need
+                size_t column = 0;
+                const char* field = line;
+                while (column < needed && field <= line_end) {
+                    const char* field_end = find_byte(field, line_end, options.delimiter);
+                    if (column == options.key_column) {
+                        fields[0] = std::string_view(field, static_cast<size_t>(field_end - field));
+                    }
+                    if (column == options.value_column) {
+                        fields[1] = std::string_view(field, static_cast<size_t>(field_end - field));
+                    }
+                    column++;
+                    field = field_end + 1;
+                }
+
+                if (line == line_end || column < needed ||
+                    !worker_convert(fields[0], fields[1], key, value)) {
+                    worker_skipped++;
+                } else {
+                    batch.emplace_back(std::move(key), std::move(value));
+                    if (batch.size() == INGEST_BATCH_ROWS) {
+                        map.insert_batch(batch.begin(), batch.end());
+                        worker_rows += batch.size();
+                        batch.clear();
+                    }
+                }
+                line = newline + 1;
+            }
+        }
+        map.insert_batch(batch.begin(), batch.end());
+        worker_rows += batch.size();
+        rows.fetch_add(worker_rows, std::memory_order_relaxed);
+        skipped.fetch_add(worker_skipped, std::memory_order_relaxed);
+    });
+
+    stats.rows = rows.load(std::memory_order_relaxed);
+    stats.skipped = skipped.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// String keys and values, copied as they appear in the file
+inline IngestStats ingest_delimited(const MappedFile& file, LockFreeHashMap<std::string, std::string>& map,
+                                    const IngestOptions& options = IngestOptions()) {
+    return ingest_delimited(file, map, options,
+                            [](std::string_view key_field, std::string_view value_field,
+                               std::string& key, std::string& value) {
+                                key.assign(key_field.data(), key_field.size());
+                                value.assign(value_field.data(), value_field.size());
+                                return true;
+                            });
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Count-min sketch of 4-bit counters estimating how often a key has been seen
+// recently (the TinyLFU frequency filter). Four rows, sixteen counters per
+// 64-bit word; all four counters of a key live in one 64-byte block, so an
+// increment touches a single cache line.
+//
+// Increments are relaxed CAS loops on the packed words and stop writing once a
+// key's counters saturate at 15, so hot keys stop dirtying the line. After
+// sample_size increments every counter is halved, letting old popularity decay
+class FrequencySketch {
+private:
+    static constexpr size_t ROWS = 4;
+    static constexpr size_t WORDS_PER_BLOCK = 8; // One cache line
+    static constexpr uint8_t MAX_COUNT = 15;
+    static constexpr uint64_t HALVING_MASK = 0x7777777777777777ULL;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> table;
+    size_t block_mask;
+    size_t word_count;
+    uint64_t sample_size;
+    std::atomic<uint64_t> additions{0};
+
+    static uint64_t spread(uint64_t hash) {
+        hash ^= hash >> 31;
+        hash *= 0xC4CEB9FE1A85EC53ULL;
+        hash ^= hash >> 29;
+        return hash;
+    }
+
+    // Word and nibble shift of row's counter for a spread hash
+    std::atomic<uint64_t>& counter_word(uint64_t h, size_t row, unsigned& shift) const {
+        size_t block = static_cast<size_t>(h) & block_mask;
+        uint64_t row_bits = h >> (32 + 8 * row);
+        shift = static_cast<unsigned>((row_bits >> 1) & 15) * 4;
+        return table[block * WORDS_PER_BLOCK + row * 2 + (row_bits & 1)];
+    }
+
+    void halve() {
+        for (size_t i = 0; i < word_count; i++) {
+            uint64_t word = table[i].load(std::memory_order_relaxed);
+            while (!table[i].compare_exchange_weak(word, (word >> 1) & HALVING_MASK,
+                                                   std::memory_order_relaxed)) {
+            }
+        }
+    }
+
+public:
+    // Sized for about expected_entries distinct keys; counters are halved
+    // every 10 * expected_entries recorded accesses
+    explicit FrequencySketch(size_t expected_entries) {
+        size_t words = WORDS_PER_BLOCK;
+        while (words < expected_entries) {
+            words <<= 1;
+        }
+        word_count = words;
+        block_mask = words / WORDS_PER_BLOCK - 1;
+        sample_size = 10 * static_cast<uint64_t>(expected_entries < 1 ? 1 : expected_entries);
+        table.reset(new std::atomic<uint64_t>[words]);
+        for (size_t i = 0; i < words; i++) {
+            table[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    FrequencySketch(const FrequencySketch&) = delete;
+    FrequencySketch& operator=(const FrequencySketch&) = delete;
+
+    // Record one access to the key with this hash
+    void increment(uint64_t hash) {
+        uint64_t h = spread(hash);
+        bool added = false;
+        for (size_t row = 0; row < ROWS; row++) {
+            unsigned shift;
+            std::atomic<uint64_t>& word = counter_word(h, row, shift);
+            uint64_t value = word.load(std::memory_order_relaxed);
+            while (((value >> shift) & 15) < MAX_COUNT) {
+                if (word.compare_exchange_weak(value, value + (uint64_t{1} << shift),
+                                               std::memory_order_relaxed)) {
+                    added = true;
+                    break;
+                }
+            }
+        }
+        if (added && additions.fetch_add(1, std::memory_order_relaxed) + 1 == sample_size) {
+            halve();
+            additions.fetch_sub(sample_size / 2, std::memory_order_relaxed);
+        }
+    }
+
+    // Estimated recent accesses, 0-15
+    unsigned estimate(uint64_t hash) const {
+        uint64_t h = spread(hash);
+        unsigned result = MAX_COUNT;
+        for (size_t row = 0; row < ROWS; row++) {
+            unsigned shift;
+            uint64_t value = counter_word(h, row, shift).load(std::memory_order_relaxed);
+            unsigned count = static_cast<unsigned>((value >> shift) & 15);
+            if (count < result) {
+                result = count;
+            }
+        }
+        return result;
+    }
+};
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "snapshot.hpp"
+
+// Immutable open-addressing table produced by LockFreeHashMap::freeze()
+//
+// The in-memory image is exactly the file image: a 64-byte header, one tag
+// byte per slot (0 = empty, otherwise 0x80 | top hash bits) and a dense slot
+// array of {key, value}. write() stores it and open() mmaps it read-only, so
+// any number of processes can share one copy with no deserialization, atomics
+// or pointers. Keys are hashed by their bytes with a fixed seed, so the layout
+// is identical in every process
+template<typename K, typename V>
+class FrozenHashMap {
+    static_assert(std::has_unique_object_representations<K>::value,
+                  "frozen keys are hashed and compared bytewise, so K must have no padding");
+    static_assert(std::is_trivially_copyable<V>::value,
+                  "frozen values are stored as raw bytes, so V must be trivially copyable");
+
+public:
+    struct Slot {
+        K key;
+        V value;
+    };
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order_mark;
+        uint32_t key_size;
+        uint32_t value_size;
+        uint64_t slot_count;
+        uint64_t entry_count;
+        uint64_t slots_offset;
+        uint64_t data_checksum; // Over everything after the header
+        uint64_t checksum;      // Over all preceding header bytes
+    };
+
+    static_assert(sizeof(Header) == 64, "frozen header layout changed");
+
+    static constexpr char MAGIC[8] = {'L', 'F', 'H', 'M', 'F', 'R', 'O', 'Z'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t HASH_SEED = 0x6C6F636B66726565ULL;
+    static constexpr size_t ALIGNMENT = 64;
+
+    unsigned char* image = nullptr;
+    size_t image_size = 0;
+    bool mapped = false;
+
+    const Header* header = nullptr;
+    const uint8_t* tags = nullptr;
+    const Slot* slots = nullptr;
+    uint64_t mask = 0;
+
+    static size_t align_up(size_t n) {
+        return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    static uint64_t hash_key(const K& key) {
+        return snapshot_checksum(&key, sizeof(K), HASH_SEED);
+    }
+
+    static uint8_t tag_for(uint64_t hash) {
+        return static_cast<uint8_t>((hash >> 57) | 0x80);
+    }
+
+    void attach() {
+        header = reinterpret_cast<const Header*>(image);
+        tags = image + sizeof(Header);
+        slots = reinterpret_cast<const Slot*>(image + header->slots_offset);
+        mask = header->slot_count - 1;
+    }
+
+    void release() {
+        if (image == nullptr) {
+            return;
+        }
+        if (mapped) {
+            ::munmap(image, image_size);
+        } else {
+            ::operator delete(image, std::align_val_t(ALIGNMENT));
+        }
+        image = nullptr;
+    }
+
+    FrozenHashMap() = default;
+
+public:
+    // Build from any source with for_each(fn(const K&, const V&)) visiting unique keys
+    template<typename Source>
+    static FrozenHashMap build(const Source& source) {
+        std::vector<std::pair<K, V>> entries;
+        source.for_each([&entries](const K& key, const V& value) {
+            entries.emplace_back(key, value);
+        });
+
+        // Power-of-two slot count at <= 80% load
+        uint64_t slot_count = 8;
+        while (slot_count * 4 < entries.size() * 5) {
+            slot_count <<= 1;
+        }
+
+        size_t slots_offset = align_up(sizeof(Header) + slot_count);
+        size_t size = slots_offset + slot_count * sizeof(Slot);
+
+        FrozenHashMap frozen;
+        frozen.image = static_cast<unsigned char*>(::operator new(size, std::align_val_t(ALIGNMENT)));
+        frozen.image_size = size;
+        std::memset(frozen.image, 0, size);
+
+        Header* h = reinterpret_cast<Header*>(frozen.image);
+        std::memcpy(h->magic, MAGIC, sizeof(MAGIC));
+        h->version = VERSION;
+        h->byte_order_mark = SnapshotHeader::BYTE_ORDER_MARK;
+        h->key_size = sizeof(K);
+        h->value_size = sizeof(V);
+        h->slot_count = slot_count;
+        h->slots_offset = slots_offset;
+        frozen.attach();
+
+        uint8_t* tag_array = frozen.image + sizeof(Header);
+        Slot* slot_array = reinterpret_cast<Slot*>(frozen.image + slots_offset);
+        uint64_t entry_count = 0;
+        for (const auto& entry : entries) {
+            uint64_t hash = hash_key(entry.first);
+            uint64_t index = hash & frozen.mask;
+            bool duplicate = false;
+            while (tag_array[index] != 0) {
+                if (std::memcmp(&slot_array[index].key, &entry.first, sizeof(K)) == 0) {
+                    duplicate = true;
+                    break;
+                }
+                index = (index + 1) & frozen.mask;
+            }
+            if (duplicate) {
+                continue;
+            }
+            tag_array[index] = tag_for(hash);
+            std::memcpy(&slot_array[index].key, &entry.first, sizeof(K));
+            std::memcpy(&slot_array[index].value, &entry.second, sizeof(V));
+            entry_count++;
+        }
+
+        h->entry_count = entry_count;
+        h->data_checksum = snapshot_checksum(frozen.image + sizeof(Header), size - sizeof(Header));
+        h->checksum = snapshot_checksum(h, offsetof(Header, checksum));
+        return frozen;
+    }
+
+    // Map a file written by write() read-only. verify_data also checks the
+    // checksum of the whole table (touches every page; off by default so
+    // processes can share the page cache copy lazily)
+    static FrozenHashMap open(const std::string& path, bool verify_data = false) {
+        SnapshotFile file(path, O_RDONLY);
+        uint64_t size = file.size();
+        if (size < sizeof(Header)) {
+            throw std::runtime_error("frozen map " + path + " is truncated");
+        }
+
+        Header h;
+        file.read_at(&h, sizeof(h), 0);
+        if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION) {
+            throw std::runtime_error(path + " is not a supported frozen map");
+        }
+        if (h.byte_order_mark != SnapshotHeader::BYTE_ORDER_MARK ||
+            h.checksum != snapshot_checksum(&h, offsetof(Header, checksum))) {
+            throw std::runtime_error("frozen map " + path + " has a corrupt header");
+        }
+        if (h.key_size != sizeof(K) || h.value_size != sizeof(V)) {
+            throw std::runtime_error(path + " was frozen with different key/value types");
+        }
+        if (h.slot_count == 0 || (h.slot_count & (h.slot_count - 1)) != 0 ||
+            h.slot_count > size || h.slots_offset > size ||
+            h.slots_offset != align_up(sizeof(Header) + h.slot_count) ||
+            h.slot_count > (size - h.slots_offset) / sizeof(Slot) ||
+            size != h.slots_offset + h.slot_count * sizeof(Slot) ||
+            h.entry_count >= h.slot_count) {
+            throw std::runtime_error("frozen map " + path + " has an inconsistent layout");
+        }
+
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, file.descriptor(), 0);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("cannot mmap " + path + ": " + std::strerror(errno));
+        }
+
+        FrozenHashMap frozen;
+        frozen.image = static_cast<unsigned char*>(mapping);
+        frozen.image_size = size;
+        frozen.mapped = true;
+        frozen.attach();
+
+        if (verify_data &&
+            h.data_checksum != snapshot_checksum(frozen.image + sizeof(Header), size - sizeof(Header))) {
+            throw std::runtime_error("frozen map " + path + " has a corrupt table");
+        }
+        return frozen;
+    }
+
+    ~FrozenHashMap() {
+        release();
+    }
+
+    FrozenHashMap(FrozenHashMap&& other) noexcept
+        : image(other.image), image_size(other.image_size), mapped(other.mapped),
+          header(other.header), tags(other.tags), slots(other.slots), mask(other.mask) {
+        other.image = nullptr;
+    }
+
+    FrozenHashMap& operator=(FrozenHashMap&& other) noexcept {
+        if (this != &other) {
+            release();
+            image = other.image;
+            image_size = other.image_size;
+            mapped = other.mapped;
+            header = other.header;
+            tags = other.tags;
+            slots = other.slots;
+            mask = other.mask;
+            other.image = nullptr;
+        }
+        return *this;
+    }
+
+    FrozenHashMap(const FrozenHashMap&) = delete;
+    FrozenHashMap& operator=(const FrozenHashMap&) = delete;
+
+    // Store the image (via path + ".tmp", synced and durably renamed into place)
+    void write(const std::string& path) const {
+        std::string tmp_path = path + ".tmp";
+        SnapshotFile file(tmp_path, O_WRONLY | O_CREAT | O_TRUNC);
+        file.write_at(image, image_size, 0);
+        file.sync();
+        file.close();
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("cannot rename " + tmp_path + " to " + path);
+        }
+        sync_parent_directory(path);
+    }
+
+    // The probe stops after one pass over the table, so a damaged tag array
+    // with no empty slot (only caught by open()'s verify_data) cannot hang it
+    bool get(const K& key, V& value) const {
+        uint64_t hash = hash_key(key);
+        uint8_t tag = tag_for(hash);
+        uint64_t index = hash & mask;
+        for (uint64_t probes = 0; probes <= mask && tags[index] != 0; probes++, index = (index + 1) & mask) {
+            if (tags[index] == tag && std::memcmp(&slots[index].key, &key, sizeof(K)) == 0) {
+                std::memcpy(&value, &slots[index].value, sizeof(V));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool contains(const K& key) const {
+        V value;
+        return get(key, value);
+    }
+
+    template<typename F>
+    void for_each(F&& fn) const {
+        for (uint64_t index = 0; index <= mask; index++) {
+            if (tags[index] != 0) {
+                fn(slots[index].key, slots[index].value);
+            }
+        }
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(header->entry_count);
+    }
+
+    size_t slot_count() const {
+        return static_cast<size_t>(header->slot_count);
+    }
+
+    size_t memory_bytes() const {
+        return image_size;
+    }
+};
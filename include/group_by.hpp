@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "lockfree_hashmap.hpp"
+#include "parallel.hpp"
+
+// Groups produced by parallel_group_by(), one buffer per worker of the final
+// scan. Each key appears exactly once overall; order is unspecified
+template<typename K, typename A>
+struct GroupByResult {
+    std::vector<std::vector<std::pair<K, A>>> partitions;
+
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& partition : partitions) {
+            total += partition.size();
+        }
+        return total;
+    }
+
+    template<typename F>
+    void for_each(F&& fn) const {
+        for (const auto& partition : partitions) {
+            for (const auto& group : partition) {
+                fn(group.first, group.second);
+            }
+        }
+    }
+};
+
+// Rows each worker claims at a time in parallel_group_by()
+constexpr size_t GROUP_BY_MORSEL_ROWS = 16384;
+
+// Per-worker pre-aggregation table: open addressing over a fixed number of
+// slots with short linear probes. Heavy hitters stay resident and absorb most
+// of their rows locally; when a key finds no slot the whole table is flushed to
+// the shared map and cleared, so cold keys cost one shared merge each
+template<typename K, typename A>
+class PreAggregationTable {
+private:
+    static constexpr size_t SLOTS = 4096;
+    static constexpr size_t MAX_PROBES = 8;
+
+    struct Slot {
+        K key;
+        A value;
+        bool used = false;
+    };
+
+    std::vector<Slot> slots;
+    std::hash<K> hasher;
+
+    size_t home(const K& key) const {
+        uint64_t h = hasher(key);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h) & (SLOTS - 1);
+    }
+
+public:
+    PreAggregationTable() : slots(SLOTS) {}
+
+    template<typename Combine>
+    void add(LockFreeHashMap<K, A>& shared, const K& key, const A& value, Combine& combine) {
+        size_t start = home(key);
+        for (size_t probe = 0; probe < MAX_PROBES; probe++) {
+            Slot& slot = slots[(start + probe) & (SLOTS - 1)];
+            if (!slot.used) {
+                slot.key = key;
+                slot.value = value;
+                slot.used = true;
+                return;
+            }
+            if (slot.key == key) {
+                slot.value = combine(static_cast<const A&>(slot.value), value);
+                return;
+            }
+        }
+        flush(shared, combine);
+        Slot& slot = slots[start];
+        slot.key = key;
+        slot.value = value;
+        slot.used = true;
+    }
+
+    template<typename Combine>
+    void flush(LockFreeHashMap<K, A>& shared, Combine& combine) {
+        for (Slot& slot : slots) {
+            if (slot.used) {
+                shared.merge(slot.key, slot.value, combine);
+                slot.used = false;
+            }
+        }
+    }
+};
+
+// Aggregate (key, value) rows per key with combine(A, A) -> A, which must be
+// associative and commutative (sum, min, max, count...). Workers claim morsels
+// of rows, pre-aggregate them in a thread-local table and flush the partial
+// aggregates into one shared LockFreeHashMap with LockFreeHashMap::merge(); a
+// parallel scan over bucket ranges then reads the groups out. A must suit
+// merge(): trivially copyable, 1-8 bytes. expected_groups sizes the shared map
+// (0 means one bucket per row); threads == 0 uses every hardware thread
+template<typename K, typename A, typename Combine>
+GroupByResult<K, A> parallel_group_by(const std::vector<std::pair<K, A>>& rows, Combine combine,
+                                      size_t threads = 0, size_t expected_groups = 0) {
+    if (threads == 0) {
+        threads = default_parallelism();
+    }
+    GroupByResult<K, A> result;
+    result.partitions.resize(threads);
+    if (rows.empty()) {
+        return result;
+    }
+
+    LockFreeHashMap<K, A> groups(expected_groups != 0 ? expected_groups : rows.size());
+    std::atomic<size_t> cursor{0};
+
+    run_parallel(threads, [&](size_t) {
+        PreAggregationTable<K, A> local;
+        Combine worker_combine = combine;
+        size_t first;
+        while ((first = cursor.fetch_add(GROUP_BY_MORSEL_ROWS, std::memory_order_relaxed)) <
+               rows.size()) {
+            size_t last = std::min(first + GROUP_BY_MORSEL_ROWS, rows.size());
+            for (size_t row = first; row < last; row++) {
+                local.add(groups, rows[row].first, rows[row].second, worker_combine);
+            }
+        }
+        local.flush(groups, worker_combine);
+    });
+
+    size_t buckets = groups.bucket_count();
+    size_t per_worker = (buckets + threads - 1) / threads;
+    run_parallel(threads, [&](size_t worker) {
+        auto& out = result.partitions[worker];
+        size_t first = worker * per_worker;
+        groups.for_each_in_buckets(first, std::min(first + per_worker, buckets),
+                                   [&out](const K& key, const A& value) {
+                                       out.emplace_back(key, value);
+                                   });
+    });
+
+    return result;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "lockfree_hashmap.hpp"
+#include "parallel.hpp"
+
+// One output row of parallel_hash_join()
+template<typename K, typename B, typename P>
+struct JoinMatch {
+    K key;
+    B build;
+    P probe;
+};
+
+// Matches of a parallel_hash_join(), in one buffer per worker thread so the
+// workers never share an output vector. Order across and within buffers is
+// unspecified
+template<typename K, typename B, typename P>
+struct HashJoinResult {
+    std::vector<std::vector<JoinMatch<K, B, P>>> partitions;
+
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& partition : partitions) {
+            total += partition.size();
+        }
+        return total;
+    }
+
+    template<typename F>
+    void for_each(F&& fn) const {
+        for (const auto& partition : partitions) {
+            for (const auto& match : partition) {
+                fn(match);
+            }
+        }
+    }
+};
+
+// Rows each worker claims at a time in parallel_hash_join()
+constexpr size_t HASH_JOIN_MORSEL_ROWS = 16384;
+
+// Inner equi-join of (key, payload) rows. Build: workers insert build_rows into
+// a LockFreeHashMap sized to one bucket per build row. Probe: workers claim
+// morsels of probe_rows from a shared cursor (so skew evens out) and look them
+// up with probe_batch(), which overlaps the cache misses of each group of keys.
+// Duplicate keys on either side produce every pairing. threads == 0 uses one
+// worker per hardware thread
+template<typename K, typename B, typename P>
+HashJoinResult<K, B, P> parallel_hash_join(const std::vector<std::pair<K, B>>& build_rows,
+                                           const std::vector<std::pair<K, P>>& probe_rows,
+                                           size_t threads = 0) {
+    if (threads == 0) {
+        threads = default_parallelism();
+    }
+    HashJoinResult<K, B, P> result;
+    result.partitions.resize(threads);
+    if (build_rows.empty() || probe_rows.empty()) {
+        return result;
+    }
+
+    LockFreeHashMap<K, B> table(build_rows.size());
+    std::atomic<size_t> build_cursor{0};
+    std::atomic<size_t> probe_cursor{0};
+
+    run_parallel(threads, [&](size_t) {
+        size_t first;
+        while ((first = build_cursor.fetch_add(HASH_JOIN_MORSEL_ROWS, std::memory_order_relaxed)) <
+               build_rows.size()) {
+            size_t last = std::min(first + HASH_JOIN_MORSEL_ROWS, build_rows.size());
+            for (size_t row = first; row < last; row++) {
+                table.insert(build_rows[row].first, build_rows[row].second);
+            }
+        }
+    });
+
+    run_parallel(threads, [&](size_t worker) {
+        auto& out = result.partitions[worker];
+        size_t first;
+        while ((first = probe_cursor.fetch_add(HASH_JOIN_MORSEL_ROWS, std::memory_order_relaxed)) <
+               probe_rows.size()) {
+            size_t count = std::min(HASH_JOIN_MORSEL_ROWS, probe_rows.size() - first);
+            table.probe_batch(
+                count,
+                [&](size_t i) -> const K& { return probe_rows[first + i].first; },
+                [&](size_t i, const B& build) {
+                    const auto& row = probe_rows[first + i];
+                    out.push_back({row.first, build, row.second});
+                });
+        }
+    });
+
+    return result;
+}
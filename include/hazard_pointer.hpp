@@ -4,6 +4,11 @@
 #include <vector>
 #include <thread>
 #include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+#include "op_counters.hpp"
+#include "usdt_probes.hpp"
 
 // Hazard Pointer implementation for safe memory reclamation in lock-free data structures
 template<typename T>
@@ -32,21 +37,72 @@ private:
         std::thread::id thread_id;
     };
 
+    // Per-thread reclamation counters (only present with LOCKFREE_HASHMAP_ENABLE_COUNTERS)
+    enum class Counter : size_t {
+        RETIRES,
+        RECLAIM_PASSES,
+        RECLAIM_FREED,
+        RECLAIM_STILL_PROTECTED,
+        COUNT
+    };
+
+    LFHM_IF_COUNTERS(PerThreadCounters<static_cast<size_t>(Counter::COUNT)> counters;)
+
     // Global hazard pointer array (one per thread)
     std::vector<std::vector<HazardPointer>> hazard_pointers;
 
     // Retired list for each thread
     std::vector<std::vector<RetiredNode>> retired_lists;
 
-    // Thread-local index for accessing hazard pointers
-    thread_local static size_t thread_index;
-    static std::atomic<size_t> thread_counter;
+    // Thread indices are leased on a thread's first use and returned when it
+    // exits, so threads may come and go freely as long as at most MAX_THREADS
+    // use managers of this T at once; one more throws std::runtime_error.
+    // A new owner of an index inherits its predecessor's retired nodes
+    struct IndexPool {
+        std::mutex lock;
+        std::vector<size_t> released;
+        size_t next = 0;
+    };
 
-    size_t get_thread_index() {
-        if (thread_index == SIZE_MAX) {
-            thread_index = thread_counter.fetch_add(1, std::memory_order_relaxed);
+    static IndexPool& index_pool() {
+        static IndexPool* pool = new IndexPool(); // Outlives thread_local leases
+        return *pool;
+    }
+
+    class ThreadIndex {
+    private:
+        size_t index = SIZE_MAX;
+
+    public:
+        ~ThreadIndex() {
+            if (index != SIZE_MAX) {
+                IndexPool& pool = index_pool();
+                std::lock_guard<std::mutex> guard(pool.lock);
+                pool.released.push_back(index);
+            }
         }
-        return thread_index;
+
+        size_t get() {
+            if (index == SIZE_MAX) {
+                IndexPool& pool = index_pool();
+                std::lock_guard<std::mutex> guard(pool.lock);
+                if (!pool.released.empty()) {
+                    index = pool.released.back();
+                    pool.released.pop_back();
+                } else if (pool.next < MAX_THREADS) {
+                    index = pool.next++;
+                } else {
+                    throw std::runtime_error("HazardPointerManager: more than 128 threads at once");
+                }
+            }
+            return index;
+        }
+    };
+
+    thread_local static ThreadIndex thread_index;
+
+    size_t get_thread_index() {
+        return thread_index.get();
     }
 
     // Scan all hazard pointers to build protected set
@@ -116,6 +172,7 @@ public:
     void retire(T* ptr) {
         size_t idx = get_thread_index();
         retired_lists[idx].push_back({ptr, std::this_thread::get_id()});
+        LFHM_COUNT(counters, Counter::RETIRES, 1);
 
         // Try to reclaim memory if retired list is getting large
         if (retired_lists[idx].size() >= RETIRED_THRESHOLD) {
@@ -132,6 +189,8 @@ public:
             return;
         }
 
+        LFHM_PROBE1(reclaim_start, retired_list.size());
+
         // Get all currently protected pointers
         std::vector<T*> protected_ptrs = get_protected_pointers();
 
@@ -148,9 +207,47 @@ public:
             }
         }
 
+        LFHM_PROBE2(reclaim_end, retired_list.size() - still_retired.size(), still_retired.size());
+        LFHM_COUNT(counters, Counter::RECLAIM_PASSES, 1);
+        LFHM_COUNT(counters, Counter::RECLAIM_FREED, retired_list.size() - still_retired.size());
+        LFHM_COUNT(counters, Counter::RECLAIM_STILL_PROTECTED, still_retired.size());
+
         retired_list = std::move(still_retired);
     }
 
+    // Free every thread's retired nodes without checking hazards. Only safe once
+    // no thread can reach the owning structure any more (e.g. its destructor)
+    void reclaim_all() {
+        for (auto& retired_list : retired_lists) {
+            for (auto& node : retired_list) {
+                delete node.ptr;
+            }
+            LFHM_COUNT(counters, Counter::RECLAIM_FREED, retired_list.size());
+            retired_list.clear();
+        }
+    }
+
+    // Aggregated reclamation counters across all threads
+    // All fields read zero unless built with LOCKFREE_HASHMAP_ENABLE_COUNTERS
+    struct ReclaimCounters {
+        uint64_t retires = 0;
+        uint64_t reclaim_passes = 0;
+        uint64_t reclaim_freed = 0;
+        uint64_t reclaim_still_protected = 0;
+    };
+
+    ReclaimCounters reclaim_counters() const {
+        ReclaimCounters result;
+#ifdef LOCKFREE_HASHMAP_ENABLE_COUNTERS
+        auto totals = counters.sum();
+        result.retires = totals[static_cast<size_t>(Counter::RETIRES)];
+        result.reclaim_passes = totals[static_cast<size_t>(Counter::RECLAIM_PASSES)];
+        result.reclaim_freed = totals[static_cast<size_t>(Counter::RECLAIM_FREED)];
+        result.reclaim_still_protected = totals[static_cast<size_t>(Counter::RECLAIM_STILL_PROTECTED)];
+#endif
+        return result;
+    }
+
     // RAII helper for automatic acquire/release
     class Guard {
     private:
@@ -183,7 +280,4 @@ public:
 
 // Static member initialization
 template<typename T>
-thread_local size_t HazardPointerManager<T>::thread_index = SIZE_MAX;
-
-template<typename T>
-std::atomic<size_t> HazardPointerManager<T>::thread_counter{0};
\ No newline at end of file
+thread_local typename HazardPointerManager<T>::ThreadIndex HazardPointerManager<T>::thread_index;
\ No newline at end of file
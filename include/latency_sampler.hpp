@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "log_histogram.hpp"
+#include "op_counters.hpp"
+
+// Default 1-in-N interval for LatencySampler
+#ifndef LOCKFREE_HASHMAP_LATENCY_SAMPLE_INTERVAL
+#define LOCKFREE_HASHMAP_LATENCY_SAMPLE_INTERVAL 1024
+#endif
+
+// Cheapest available monotonic tick source: TSC on x86, the virtual counter on
+// AArch64, steady_clock nanoseconds elsewhere
+class TickClock {
+private:
+    struct Anchor {
+        uint64_t ticks;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    static const Anchor& anchor() {
+        static const Anchor first = {now(), std::chrono::steady_clock::now()};
+        return first;
+    }
+
+public:
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t ticks;
+        __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // Start the calibration window early so ns_per_tick() rarely has to wait
+    static void start_calibration() {
+        anchor();
+    }
+
+    // Nanoseconds per tick, measured against steady_clock since the first call
+    // to start_calibration() (waits until at least 5ms have passed)
+    static double ns_per_tick() {
+#if defined(__x86_64__) || defined(__i386__)
+        const Anchor& first = anchor();
+        auto elapsed = std::chrono::steady_clock::now() - first.time;
+        while (elapsed < std::chrono::milliseconds(5)) {
+            elapsed = std::chrono::steady_clock::now() - first.time;
+        }
+        uint64_t ticks = now() - first.ticks;
+        double ns = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        return ticks == 0 ? 1.0 : ns / static_cast<double>(ticks);
+#elif defined(__aarch64__)
+        uint64_t frequency;
+        __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(frequency));
+        return frequency == 0 ? 1.0 : 1e9 / static_cast<double>(frequency);
+#else
+        return 1.0;
+#endif
+    }
+};
+
+// Merged latency samples for one operation type
+struct LatencySnapshot {
+    LogHistogram ticks;
+    double ns_per_tick = 1.0;
+
+    uint64_t count() const {
+        return ticks.count();
+    }
+
+    double percentile_ns(double q) const {
+        return static_cast<double>(ticks.percentile(q)) * ns_per_tick;
+    }
+
+    double mean_ns() const {
+        return ticks.count() == 0
+            ? 0.0
+            : static_cast<double>(ticks.sum()) * ns_per_tick / static_cast<double>(ticks.count());
+    }
+};
+
+// Times one in every N calls per thread and records the tick count into a
+// per-thread LogHistogram per operation type. Each thread's countdown lives
+// next to its histograms in its per_thread_counter_slot() of this sampler, so
+// maps with different intervals do not disturb each other; the unsampled path
+// is a slot lookup, a decrement, a load of a rarely written atomic and a
+// branch. Threads sharing the overflow slot count down and record with atomic
+// read-modify-writes, as in PerThreadCounters, and sample roughly one in N
+template<size_t OPS>
+class LatencySampler {
+private:
+    static constexpr size_t SLOTS = PER_THREAD_COUNTER_SLOTS + 1; // Leased + overflow
+
+    struct ThreadHistograms {
+        std::atomic<uint32_t> remaining{1};
+        std::atomic<uint32_t> seen_generation{0}; // generation when remaining was loaded
+        LogHistogram ops[OPS];
+    };
+
+    std::unique_ptr<std::atomic<ThreadHistograms*>[]> slots;
+    std::atomic<uint32_t> interval;
+    // Bumped by every set_interval(), so threads reload a countdown loaded
+    // from the old interval (e.g. UINT32_MAX while sampling was off) at once
+    std::atomic<uint32_t> generation{0};
+
+    ThreadHistograms& local(size_t index) {
+        std::atomic<ThreadHistograms*>& slot = slots[index];
+        ThreadHistograms* histograms = slot.load(std::memory_order_acquire);
+        if (histograms == nullptr) {
+            ThreadHistograms* fresh = new ThreadHistograms();
+            if (slot.compare_exchange_strong(histograms, fresh,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+                histograms = fresh;
+            } else {
+                delete fresh;
+            }
+        }
+        return *histograms;
+    }
+
+public:
+    explicit LatencySampler(uint32_t sample_interval = LOCKFREE_HASHMAP_LATENCY_SAMPLE_INTERVAL)
+        : slots(new std::atomic<ThreadHistograms*>[SLOTS]), interval(sample_interval) {
+        for (size_t i = 0; i < SLOTS; i++) {
+            slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+        TickClock::start_calibration();
+    }
+
+    ~LatencySampler() {
+        for (size_t i = 0; i < SLOTS; i++) {
+            delete slots[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    LatencySampler(const LatencySampler&) = delete;
+    LatencySampler& operator=(const LatencySampler&) = delete;
+
+    // 0 turns sampling off; each thread picks the change up on its next
+    // operation (sampled when the new interval is non-zero)
+    void set_interval(uint32_t sample_interval) {
+        interval.store(sample_interval, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+
+    // True when the calling thread should time its next operation
+    bool due() {
+        size_t index = per_thread_counter_slot();
+        ThreadHistograms& histograms = local(index);
+        uint32_t current = generation.load(std::memory_order_acquire);
+        uint32_t remaining;
+        if (index < PER_THREAD_COUNTER_SLOTS) {
+            remaining = histograms.remaining.load(std::memory_order_relaxed) - 1;
+            histograms.remaining.store(remaining, std::memory_order_relaxed);
+        } else {
+            remaining = histograms.remaining.fetch_sub(1, std::memory_order_relaxed) - 1;
+        }
+        if (remaining != 0 && histograms.seen_generation.load(std::memory_order_relaxed) == current) {
+            return false;
+        }
+        uint32_t next = interval.load(std::memory_order_relaxed);
+        histograms.remaining.store(next != 0 ? next : UINT32_MAX, std::memory_order_relaxed);
+        histograms.seen_generation.store(current, std::memory_order_relaxed);
+        return next != 0;
+    }
+
+    template<typename F>
+    auto time(size_t op, F&& operation) -> decltype(operation()) {
+        uint64_t start = TickClock::now();
+        auto result = operation();
+        uint64_t elapsed = TickClock::now() - start;
+        size_t index = per_thread_counter_slot();
+        if (index < PER_THREAD_COUNTER_SLOTS) {
+            local(index).ops[op].record_owned(elapsed);
+        } else {
+            local(index).ops[op].record(elapsed);
+        }
+        return result;
+    }
+
+    LatencySnapshot snapshot(size_t op) const {
+        LatencySnapshot merged;
+        for (size_t i = 0; i < SLOTS; i++) {
+            const ThreadHistograms* histograms = slots[i].load(std::memory_order_acquire);
+            if (histograms != nullptr) {
+                merged.ticks.merge(histograms->ops[op]);
+            }
+        }
+        merged.ns_per_tick = TickClock::ns_per_tick();
+        return merged;
+    }
+};
@@ -1,11 +1,45 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "coro_lookup.hpp"
+#include "frozen_hashmap.hpp"
+#include "latency_sampler.hpp"
+#include "mutation_feed.hpp"
+#include "op_counters.hpp"
+#include "parallel.hpp"
+#include "perfect_hash.hpp"
+#include "snapshot.hpp"
+#include "usdt_probes.hpp"
+
+// Bookkeeping locals shared by the counters and the USDT probes
+#if defined(LOCKFREE_HASHMAP_ENABLE_COUNTERS) || defined(LFHM_USDT_ACTIVE)
+#define LFHM_IF_INSTRUMENTED(...) __VA_ARGS__
+#else
+#define LFHM_IF_INSTRUMENTED(...)
+#endif
+
+// Version stamps on nodes for point-in-time snapshot() views
+#ifdef LOCKFREE_HASHMAP_ENABLE_MVCC
+#define LFHM_IF_MVCC(...) __VA_ARGS__
+#else
+#define LFHM_IF_MVCC(...)
+#endif
+
 template<typename K, typename V>
 class LockFreeHashMap {
 private:
@@ -14,86 +48,647 @@ private:
         V value;
         std::atomic<Node*> next;
         std::atomic<bool> deleted; // Logical deletion flag
+        std::atomic<uint32_t> state{NODE_READY}; // value is only readable once NODE_READY
+        LFHM_IF_MVCC(std::atomic<uint64_t> inserted_at{VERSION_PENDING};)
+        LFHM_IF_MVCC(std::atomic<uint64_t> deleted_at{VERSION_PENDING};)
 
         Node(const K& k, const V& v) : key(k), value(v), next(nullptr), deleted(false) {}
     };
 
+    // Node::state. Placeholders linked by get_or_compute() stay NODE_COMPUTING
+    // until their factory returns; readers treat them as absent
+    static constexpr uint32_t NODE_READY = 0;
+    static constexpr uint32_t NODE_COMPUTING = 1;
+    static constexpr uint32_t NODE_FAILED = 2; // Factory threw; node is deleted
+
+    static bool ready(const Node* node) {
+        return node->state.load(std::memory_order_acquire) == NODE_READY;
+    }
+
+    // Block until a get_or_compute() placeholder is filled in or abandoned
+    static uint32_t wait_computed(const Node* node) {
+        uint32_t state = node->state.load(std::memory_order_acquire);
+#if defined(__cpp_lib_atomic_wait)
+        while (state == NODE_COMPUTING) {
+            node->state.wait(NODE_COMPUTING, std::memory_order_acquire);
+            state = node->state.load(std::memory_order_acquire);
+        }
+#else
+        for (unsigned spins = 0; state == NODE_COMPUTING; spins++) {
+            if (spins < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            state = node->state.load(std::memory_order_acquire);
+        }
+#endif
+        return state;
+    }
+
+    // Newest node of key that is not deleted, from head on, including
+    // unfinished get_or_compute() placeholders
+    static Node* find_live(Node* head, const K& key) {
+        Node* current = head;
+        while (current != nullptr &&
+               (current->deleted.load(std::memory_order_acquire) || !(current->key == key))) {
+            current = current->next.load(std::memory_order_acquire);
+        }
+        return current;
+    }
+
+    static void finish_computing(Node* node, uint32_t state) {
+        node->state.store(state, std::memory_order_release);
+#if defined(__cpp_lib_atomic_wait)
+        node->state.notify_all();
+#endif
+    }
+
     std::vector<std::atomic<Node*>> buckets;
     size_t capacity;
     std::hash<K> hasher;
+    MutationFeed<K, V>* mutation_feed = nullptr;
 
-    size_t get_bucket_index(const K& key) const {
-        return hasher(key) % capacity;
+#ifdef LOCKFREE_HASHMAP_ENABLE_MVCC
+    // A node is visible to the snapshot taken at version s when
+    // inserted_at <= s < deleted_at. Writers stamp the current clock right
+    // after their CAS and snapshot() advances it, so later writes stamp > s.
+    // Until stamped, a linked node reads VERSION_PENDING and snapshot readers
+    // wait for the writer to finish its stamp
+    static constexpr uint64_t VERSION_PENDING = UINT64_MAX;
+    mutable std::atomic<uint64_t> version_clock{0};
+
+    // The fence here and the one in snapshot() make each side see the other:
+    // either the snapshot traversal sees this write, or the write reads a clock
+    // already past the snapshot version
+    void stamp(std::atomic<uint64_t>& field) const {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        field.store(version_clock.load());
     }
 
-public:
-    explicit LockFreeHashMap(size_t initial_capacity = 16)
-        : buckets(initial_capacity), capacity(initial_capacity) {
-        for (auto& bucket : buckets) {
-            bucket.store(nullptr, std::memory_order_relaxed);
+    static uint64_t wait_for_stamp(const std::atomic<uint64_t>& stamp) {
+        uint64_t version = stamp.load();
+        while (version == VERSION_PENDING) {
+            std::this_thread::yield();
+            version = stamp.load();
         }
+        return version;
     }
 
-    ~LockFreeHashMap() {
-        // Clean up all nodes
-        for (auto& bucket : buckets) {
-            Node* current = bucket.load(std::memory_order_relaxed);
-            while (current != nullptr) {
-                Node* next = current->next.load(std::memory_order_relaxed);
-                delete current;
-                current = next;
+    static bool visible_at(const Node* node, uint64_t version) {
+        if (!ready(node) || wait_for_stamp(node->inserted_at) > version) {
+            return false;
+        }
+        // Not yet deleted: any later delete is stamped after this snapshot
+        if (!node->deleted.load()) {
+            return true;
+        }
+        return wait_for_stamp(node->deleted_at) > version;
+    }
+
+    // for_each_visible() as of a snapshot version
+    template<typename F>
+    void for_each_visible_at(size_t index, uint64_t version, std::vector<const K*>& seen,
+                             F&& fn) const {
+        seen.clear();
+        for (Node* current = buckets[index].load(std::memory_order_acquire);
+             current != nullptr;
+             current = current->next.load(std::memory_order_acquire)) {
+            if (!visible_at(current, version)) {
+                continue;
+            }
+            bool shadowed = false;
+            for (const K* key : seen) {
+                if (*key == current->key) {
+                    shadowed = true;
+                    break;
+                }
+            }
+            if (!shadowed) {
+                seen.push_back(&current->key);
+                fn(current);
             }
         }
     }
+#endif
 
-    // Insert - allows duplicate keys
-    bool insert(const K& key, const V& value) {
+    size_t get_bucket_index(const K& key) const {
+        return hasher(key) % capacity;
+    }
+
+    // Per-thread operation counters (only present with LOCKFREE_HASHMAP_ENABLE_COUNTERS)
+    enum class Counter : size_t {
+        GET_HITS,
+        GET_MISSES,
+        GET_NODES_TRAVERSED,
+        INSERTS,
+        INSERT_CAS_ATTEMPTS,
+        INSERT_CAS_FAILURES,
+        REMOVE_HITS,
+        REMOVE_MISSES,
+        REMOVE_NODES_TRAVERSED,
+        REMOVE_CAS_ATTEMPTS,
+        REMOVE_CAS_FAILURES,
+        COUNT
+    };
+
+    LFHM_IF_COUNTERS(mutable PerThreadCounters<static_cast<size_t>(Counter::COUNT)> counters;)
+
+#ifdef LFHM_USDT_ACTIVE
+    // Fires the long_chain USDT probe for walks past the configured threshold
+    static void probe_long_chain(size_t index, uint64_t traversed) {
+        if (traversed >= LOCKFREE_HASHMAP_LONG_CHAIN_PROBE_THRESHOLD) {
+            LFHM_PROBE2(long_chain, index, traversed);
+        }
+    }
+#endif
+
+    bool insert_impl(const K& key, const V& value, bool publish = true) {
         size_t index = get_bucket_index(key);
         Node* new_node = new Node(key, value);
+        LFHM_IF_INSTRUMENTED(uint64_t cas_attempts = 0;)
 
         while (true) {
             Node* head = buckets[index].load(std::memory_order_acquire);
             new_node->next.store(head, std::memory_order_relaxed);
+            LFHM_IF_INSTRUMENTED(cas_attempts++;)
 
             if (buckets[index].compare_exchange_weak(
                     head, new_node,
                     std::memory_order_release,
                     std::memory_order_acquire)) {
+                LFHM_COUNT(counters, Counter::INSERTS, 1);
+                LFHM_COUNT(counters, Counter::INSERT_CAS_ATTEMPTS, cas_attempts);
+                LFHM_COUNT(counters, Counter::INSERT_CAS_FAILURES, cas_attempts - 1);
+                LFHM_IF_MVCC(stamp(new_node->inserted_at);)
+                if (publish && mutation_feed != nullptr) {
+                    mutation_feed->publish(MutationFeed<K, V>::Type::INSERT, key, &value);
+                }
                 return true;
             }
+            LFHM_PROBE2(insert_cas_retry, index, cas_attempts);
         }
     }
 
-    // Get - skips logically deleted nodes
-    bool get(const K& key, V& value) const {
+    // Link the ready-made chain first -> ... -> last in front of a bucket with
+    // one CAS; used by BufferedWriter
+    void splice_chain(size_t index, Node* first, Node* last, uint64_t count) {
+        LFHM_IF_INSTRUMENTED(uint64_t cas_attempts = 0;)
+        Node* head = buckets[index].load(std::memory_order_acquire);
+        do {
+            last->next.store(head, std::memory_order_relaxed);
+            LFHM_IF_INSTRUMENTED(cas_attempts++;)
+        } while (!buckets[index].compare_exchange_weak(head, first,
+                                                       std::memory_order_release,
+                                                       std::memory_order_acquire));
+        LFHM_COUNT(counters, Counter::INSERTS, count);
+        LFHM_COUNT(counters, Counter::INSERT_CAS_ATTEMPTS, cas_attempts);
+        LFHM_COUNT(counters, Counter::INSERT_CAS_FAILURES, cas_attempts - 1);
+        LFHM_IF_MVCC(for (Node* node = first; node != head; node = node->next.load(std::memory_order_relaxed)) {
+            stamp(node->inserted_at);
+            if (node->deleted.load(std::memory_order_relaxed)) {
+                stamp(node->deleted_at);
+            }
+        })
+        (void)count;
+    }
+
+    bool get_impl(const K& key, V& value) const {
         size_t index = get_bucket_index(key);
         Node* current = buckets[index].load(std::memory_order_acquire);
+        LFHM_IF_INSTRUMENTED(uint64_t traversed = 0;)
 
         while (current != nullptr) {
-            if (!current->deleted.load(std::memory_order_acquire) && current->key == key) {
+            LFHM_IF_INSTRUMENTED(traversed++;)
+            if (!current->deleted.load(std::memory_order_acquire) && current->key == key &&
+                ready(current)) {
                 value = current->value;
+                LFHM_IF_PROBES(probe_long_chain(index, traversed);)
+                LFHM_COUNT(counters, Counter::GET_HITS, 1);
+                LFHM_COUNT(counters, Counter::GET_NODES_TRAVERSED, traversed);
                 return true;
             }
             current = current->next.load(std::memory_order_acquire);
         }
+        LFHM_IF_PROBES(probe_long_chain(index, traversed);)
+        LFHM_COUNT(counters, Counter::GET_MISSES, 1);
+        LFHM_COUNT(counters, Counter::GET_NODES_TRAVERSED, traversed);
+        return false;
+    }
+
+    bool remove_impl(const K& key) {
+        size_t index = get_bucket_index(key);
+        Node* current = buckets[index].load(std::memory_order_acquire);
+        LFHM_IF_INSTRUMENTED(uint64_t traversed = 0;)
+        LFHM_IF_INSTRUMENTED(uint64_t cas_attempts = 0;)
+
+        while (current != nullptr) {
+            LFHM_IF_INSTRUMENTED(traversed++;)
+            // Unfinished get_or_compute() placeholders are absent, as for get()
+            if (!current->deleted.load(std::memory_order_acquire) && current->key == key &&
+                ready(current)) {
+                // Mark as logically deleted
+                bool expected = false;
+                LFHM_IF_INSTRUMENTED(cas_attempts++;)
+                if (current->deleted.compare_exchange_strong(
+                        expected, true,
+                        std::memory_order_release,
+                        std::memory_order_relaxed)) {
+                    LFHM_IF_PROBES(probe_long_chain(index, traversed);)
+                    LFHM_COUNT(counters, Counter::REMOVE_HITS, 1);
+                    LFHM_COUNT(counters, Counter::REMOVE_NODES_TRAVERSED, traversed);
+                    LFHM_COUNT(counters, Counter::REMOVE_CAS_ATTEMPTS, cas_attempts);
+                    LFHM_COUNT(counters, Counter::REMOVE_CAS_FAILURES, cas_attempts - 1);
+                    LFHM_IF_MVCC(stamp(current->deleted_at);)
+                    if (mutation_feed != nullptr) {
+                        mutation_feed->publish(MutationFeed<K, V>::Type::REMOVE, key, nullptr);
+                    }
+                    return true;
+                }
+            }
+            current = current->next.load(std::memory_order_acquire);
+        }
+        LFHM_IF_PROBES(probe_long_chain(index, traversed);)
+        LFHM_COUNT(counters, Counter::REMOVE_MISSES, 1);
+        LFHM_COUNT(counters, Counter::REMOVE_NODES_TRAVERSED, traversed);
+        LFHM_COUNT(counters, Counter::REMOVE_CAS_ATTEMPTS, cas_attempts);
+        LFHM_COUNT(counters, Counter::REMOVE_CAS_FAILURES, cas_attempts);
         return false;
     }
 
+    // Calls fn(node) for every node get() could return from this bucket, newest
+    // first, skipping tombstones and live nodes shadowed by a newer duplicate
+    template<typename F>
+    void for_each_visible(size_t index, std::vector<const K*>& seen, F&& fn) const {
+        seen.clear();
+        for (Node* current = buckets[index].load(std::memory_order_acquire);
+             current != nullptr;
+             current = current->next.load(std::memory_order_acquire)) {
+            if (current->deleted.load(std::memory_order_acquire) || !ready(current)) {
+                continue;
+            }
+            bool shadowed = false;
+            for (const K* key : seen) {
+                if (*key == current->key) {
+                    shadowed = true;
+                    break;
+                }
+            }
+            if (!shadowed) {
+                seen.push_back(&current->key);
+                fn(current);
+            }
+        }
+    }
+
+    // Maps with at least this many buckets are torn down in parallel
+    static constexpr size_t PARALLEL_TEARDOWN_BUCKETS = 1 << 20;
+
+    void free_buckets(size_t first, size_t last) {
+        for (size_t index = first; index < last; index++) {
+            Node* current = buckets[index].load(std::memory_order_relaxed);
+            buckets[index].store(nullptr, std::memory_order_relaxed);
+            while (current != nullptr) {
+                Node* next = current->next.load(std::memory_order_relaxed);
+                delete current;
+                current = next;
+            }
+        }
+    }
+
+    // Keys whose lookups probe_batch() overlaps
+    static constexpr size_t PROBE_BATCH = 16;
+
+    static void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    // Snapshot data is flushed to the file in chunks of about this size
+    static constexpr size_t SNAPSHOT_CHUNK_BYTES = 1 << 20;
+
+    static SnapshotHeader read_snapshot_header(const SnapshotFile& file, const std::string& path) {
+        SnapshotHeader header;
+        file.read_at(&header, sizeof(header), 0);
+
+        if (std::memcmp(header.magic, SnapshotHeader::MAGIC, sizeof(header.magic)) != 0) {
+            throw std::runtime_error(path + " is not a hash map snapshot");
+        }
+        if (header.version != SnapshotHeader::VERSION) {
+            throw std::runtime_error(path + " has unsupported snapshot version " +
+                                     std::to_string(header.version));
+        }
+        if (header.byte_order_mark != SnapshotHeader::BYTE_ORDER_MARK) {
+            throw std::runtime_error(path + " was written with a different byte order");
+        }
+        if (header.checksum != snapshot_checksum(&header, offsetof(SnapshotHeader, checksum))) {
+            throw std::runtime_error(path + " has a corrupt header");
+        }
+        if (header.key_size != SnapshotSerializer<K>::fixed_size ||
+            header.value_size != SnapshotSerializer<V>::fixed_size) {
+            throw std::runtime_error(path + " was written for different key/value types");
+        }
+        return header;
+    }
+
+public:
+    // Operations timed by the latency sampler
+    enum class LatencyOp : size_t {
+        GET,
+        INSERT,
+        REMOVE,
+        COUNT
+    };
+
+private:
+    // 1-in-N timing of get/insert/remove (only present with
+    // LOCKFREE_HASHMAP_ENABLE_LATENCY_SAMPLING)
+#ifdef LOCKFREE_HASHMAP_ENABLE_LATENCY_SAMPLING
+    mutable LatencySampler<static_cast<size_t>(LatencyOp::COUNT)> latency_sampler;
+#endif
+
+public:
+    explicit LockFreeHashMap(size_t initial_capacity = 16)
+        : buckets(initial_capacity), capacity(initial_capacity) {
+        for (auto& bucket : buckets) {
+            bucket.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~LockFreeHashMap() {
+        // Clean up all nodes; large maps free bucket ranges on the pool
+        if (capacity >= PARALLEL_TEARDOWN_BUCKETS) {
+            try {
+                size_t tasks = default_parallelism();
+                run_parallel(tasks, [this, tasks](size_t task) {
+                    free_buckets(capacity * task / tasks, capacity * (task + 1) / tasks);
+                });
+                return;
+            } catch (...) {
+                // Whatever was not freed is freed below
+            }
+        }
+        free_buckets(0, capacity);
+    }
+
+    // Insert - allows duplicate keys
+    bool insert(const K& key, const V& value) {
+#ifdef LOCKFREE_HASHMAP_ENABLE_LATENCY_SAMPLING
+        if (latency_sampler.due()) {
+            return latency_sampler.time(static_cast<size_t>(LatencyOp::INSERT),
+                                        [&] { return insert_impl(key, value); });
+        }
+#endif
+        return insert_impl(key, value);
+    }
+
+    // Insert every (key, value) pair in [first, last); a mutation feed sees
+    // the whole range as one batch, like a load() chunk
+    template<typename Iterator>
+    void insert_batch(Iterator first, Iterator last) {
+        for (Iterator row = first; row != last; ++row) {
+            insert_impl(row->first, row->second, false);
+        }
+        if (mutation_feed != nullptr) {
+            mutation_feed->publish_batch(MutationFeed<K, V>::Type::INSERT, first, last);
+        }
+    }
+
+    // Per-thread write-combining handle for insert bursts. insert() links the
+    // new node into a local chain for its bucket; flush() (called when
+    // buffer_size operations are pending and on destruction) publishes each
+    // bucket's chain with a single CAS on the bucket head. remove() of a key
+    // with a buffered insert marks that node deleted locally; otherwise it is
+    // deferred and applied at flush time before the bucket's chain is linked,
+    // so the outcome matches applying the operations in order. Other threads
+    // see nothing until the flush. Not thread-safe: use one writer per thread
+    class BufferedWriter {
+    private:
+        struct Run {
+            size_t index;
+            Node* first;     // Newest
+            Node* last;      // Oldest
+            uint64_t count;
+        };
+
+        LockFreeHashMap* map;
+        size_t capacity;
+        size_t operations = 0;
+        std::vector<Run> runs;          // Open addressing on bucket index
+        std::vector<size_t> used_runs;  // Occupied positions in runs
+        std::vector<K> removals;        // Deferred removes of published keys
+        std::vector<Node*> ordered;     // Scratch for oldest-first feed publishing
+
+        Run& run_for(size_t index) {
+            size_t mask = runs.size() - 1;
+            size_t position = (index * 0x9E3779B97F4A7C15ULL >> 20) & mask;
+            while (runs[position].first != nullptr && runs[position].index != index) {
+                position = (position + 1) & mask;
+            }
+            if (runs[position].first == nullptr) {
+                runs[position].index = index;
+                used_runs.push_back(position);
+            }
+            return runs[position];
+        }
+
+        void count_operation() {
+            if (++operations >= capacity) {
+                flush();
+            }
+        }
+
+    public:
+        explicit BufferedWriter(LockFreeHashMap& target, size_t buffer_size = 1024)
+            : map(&target), capacity(buffer_size == 0 ? 1 : buffer_size) {
+            size_t slots = 2;
+            while (slots < capacity * 2) {
+                slots *= 2;
+            }
+            runs.assign(slots, Run{0, nullptr, nullptr, 0});
+            used_runs.reserve(capacity);
+        }
+
+        ~BufferedWriter() {
+            flush();
+        }
+
+        BufferedWriter(const BufferedWriter&) = delete;
+        BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+        void insert(const K& key, const V& value) {
+            Node* node = new Node(key, value);
+            Run& run = run_for(map->get_bucket_index(key));
+            node->next.store(run.first, std::memory_order_relaxed);
+            run.last = run.last != nullptr ? run.last : node;
+            run.first = node;
+            run.count++;
+            count_operation();
+        }
+
+        void remove(const K& key) {
+            size_t index = map->get_bucket_index(key);
+            Run& run = run_for(index);
+            for (Node* node = run.first; node != nullptr; node = node->next.load(std::memory_order_relaxed)) {
+                if (!node->deleted.load(std::memory_order_relaxed) && node->key == key) {
+                    node->deleted.store(true, std::memory_order_relaxed);
+                    count_operation();
+                    return;
+                }
+            }
+            if (run.first == nullptr) {
+                used_runs.pop_back(); // Nothing buffered for this bucket
+            }
+            removals.push_back(key);
+            count_operation();
+        }
+
+        // Operations buffered and not yet applied
+        size_t buffered() const {
+            return operations;
+        }
+
+        void flush() {
+            for (const K& key : removals) {
+                map->remove_impl(key);
+            }
+            for (size_t position : used_runs) {
+                Run& run = runs[position];
+                map->splice_chain(run.index, run.first, run.last, run.count);
+                if (map->mutation_feed != nullptr) {
+                    ordered.clear();
+                    for (Node* node = run.first; node != run.last->next.load(std::memory_order_relaxed);
+                         node = node->next.load(std::memory_order_relaxed)) {
+                        ordered.push_back(node);
+                    }
+                    for (auto node = ordered.rbegin(); node != ordered.rend(); ++node) {
+                        map->mutation_feed->publish(MutationFeed<K, V>::Type::INSERT,
+                                                    (*node)->key, &(*node)->value);
+                        if ((*node)->deleted.load(std::memory_order_relaxed)) {
+                            map->mutation_feed->publish(MutationFeed<K, V>::Type::REMOVE,
+                                                        (*node)->key, nullptr);
+                        }
+                    }
+                }
+                run = Run{0, nullptr, nullptr, 0};
+            }
+            used_runs.clear();
+            removals.clear();
+            operations = 0;
+        }
+    };
+
+    BufferedWriter buffered_writer(size_t buffer_size = 1024) {
+        return BufferedWriter(*this, buffer_size);
+    }
+
+    // Get - skips logically deleted nodes
+    bool get(const K& key, V& value) const {
+#ifdef LOCKFREE_HASHMAP_ENABLE_LATENCY_SAMPLING
+        if (latency_sampler.due()) {
+            return latency_sampler.time(static_cast<size_t>(LatencyOp::GET),
+                                        [&] { return get_impl(key, value); });
+        }
+#endif
+        return get_impl(key, value);
+    }
+
+    // The value get() would copy out, in place, or nullptr. Nodes are only
+    // freed by the destructor, so the pointer stays valid for the map's
+    // lifetime even after the key is removed or overwritten. Not for maps
+    // updated with merge(), which rewrites values in place, or compacted with
+    // unlink_deleted()
+    const V* find(const K& key) const {
+        size_t index = get_bucket_index(key);
+        for (Node* current = buckets[index].load(std::memory_order_acquire);
+             current != nullptr;
+             current = current->next.load(std::memory_order_acquire)) {
+            if (!current->deleted.load(std::memory_order_acquire) && current->key == key &&
+                ready(current)) {
+                return &current->value;
+            }
+        }
+        return nullptr;
+    }
+
     // Remove - uses logical deletion (marks node as deleted without freeing memory)
     // Physical deletion happens in destructor
     // NOTE: This causes memory to accumulate until the map is destroyed
     bool remove(const K& key) {
+#ifdef LOCKFREE_HASHMAP_ENABLE_LATENCY_SAMPLING
+        if (latency_sampler.due()) {
+            return latency_sampler.time(static_cast<size_t>(LatencyOp::REMOVE),
+                                        [&] { return remove_impl(key); });
+        }
+#endif
+        return remove_impl(key);
+    }
+
+    // Publish every successful insert()/remove() (and each load() chunk as one
+    // batch) to feed; nullptr detaches. Set it before the map is shared between
+    // threads. The feed must outlive the map or be detached first.
+    // The feed is bounded and never drops records: once it holds a full ring
+    // of unconsumed records, mutating calls block until a consumer drains it
+    void set_mutation_feed(MutationFeed<K, V>* feed) {
+        mutation_feed = feed;
+    }
+
+    // Logically delete every visible copy of key except the newest, so a
+    // later remove() cannot uncover an older value. Readers keep seeing the
+    // newest value throughout. An older get_or_compute() placeholder is waited
+    // for and deleted once filled in, so its INSERT is published first.
+    // Returns the number of copies deleted
+    size_t remove_shadowed(const K& key) {
         size_t index = get_bucket_index(key);
         Node* current = buckets[index].load(std::memory_order_acquire);
+        bool newest_seen = false;
+        size_t removed = 0;
 
         while (current != nullptr) {
             if (!current->deleted.load(std::memory_order_acquire) && current->key == key) {
-                // Mark as logically deleted
+                if (newest_seen && wait_computed(current) == NODE_READY) {
+                    bool expected = false;
+                    if (current->deleted.compare_exchange_strong(
+                            expected, true,
+                            std::memory_order_release,
+                            std::memory_order_relaxed)) {
+                        LFHM_IF_MVCC(stamp(current->deleted_at);)
+                        removed++;
+                    }
+                }
+                newest_seen = true;
+            }
+            current = current->next.load(std::memory_order_acquire);
+        }
+        return removed;
+    }
+
+    // Logically delete the copy of key get() would return, but only if
+    // pred(value) holds for it. A concurrent insert() of the same key is never
+    // deleted by mistake: the node that was checked is the one marked
+    template<typename Pred>
+    bool remove_if(const K& key, Pred&& pred) {
+        size_t index = get_bucket_index(key);
+        Node* current = buckets[index].load(std::memory_order_acquire);
+
+        while (current != nullptr) {
+            if (!current->deleted.load(std::memory_order_acquire) && current->key == key &&
+                ready(current)) {
+                if (!pred(static_cast<const V&>(current->value))) {
+                    return false;
+                }
                 bool expected = false;
                 if (current->deleted.compare_exchange_strong(
                         expected, true,
                         std::memory_order_release,
                         std::memory_order_relaxed)) {
+                    LFHM_IF_MVCC(stamp(current->deleted_at);)
+                    if (mutation_feed != nullptr) {
+                        mutation_feed->publish(MutationFeed<K, V>::Type::REMOVE, key, nullptr);
+                    }
                     return true;
                 }
             }
@@ -102,6 +697,721 @@ public:
         return false;
     }
 
+    // Nodes taken out of their chains by unlink_deleted(); freed by clear()
+    // or on destruction
+    class UnlinkedNodes {
+    private:
+        friend class LockFreeHashMap;
+        std::vector<Node*> nodes;
+
+    public:
+        UnlinkedNodes() = default;
+
+        ~UnlinkedNodes() {
+            clear();
+        }
+
+        UnlinkedNodes(const UnlinkedNodes&) = delete;
+        UnlinkedNodes& operator=(const UnlinkedNodes&) = delete;
+
+        size_t size() const {
+            return nodes.size();
+        }
+
+        void clear() {
+            for (Node* node : nodes) {
+                delete node;
+            }
+            nodes.clear();
+        }
+    };
+
+    // Physically unlink the deleted nodes of key's bucket into `unlinked`.
+    // Concurrent operations may still be walking them, so the caller must not
+    // clear() them until every operation that began before this call has
+    // finished; find() pointers into them dangle from then on. Inserts and
+    // removes may run concurrently (they never rewrite a published node's
+    // next), but only one thread may unlink at a time, and not while
+    // snapshot() views are open. Returns the number of nodes unlinked
+    size_t unlink_deleted(const K& key, UnlinkedNodes& unlinked) {
+        size_t index = get_bucket_index(key);
+        size_t count = 0;
+
+        // The head races inserters, so it moves by CAS; a failed CAS leaves a
+        // new live head and the deleted node mid-chain for the loop below
+        Node* head = buckets[index].load(std::memory_order_acquire);
+        while (head != nullptr && head->deleted.load(std::memory_order_acquire)) {
+            Node* next = head->next.load(std::memory_order_acquire);
+            if (buckets[index].compare_exchange_strong(head, next,
+                                                       std::memory_order_acq_rel,
+                                                       std::memory_order_acquire)) {
+                unlinked.nodes.push_back(head);
+                count++;
+                head = next;
+            }
+        }
+
+        // Past the head only the unlinker writes next pointers
+        for (Node* previous = head; previous != nullptr;) {
+            Node* current = previous->next.load(std::memory_order_acquire);
+            if (current != nullptr && current->deleted.load(std::memory_order_acquire)) {
+                previous->next.store(current->next.load(std::memory_order_acquire),
+                                     std::memory_order_release);
+                unlinked.nodes.push_back(current);
+                count++;
+            } else {
+                previous = current;
+            }
+        }
+        return count;
+    }
+
+    // Batched lookup for probe-heavy callers such as joins: for each group of
+    // PROBE_BATCH keys, prefetch every bucket slot, then every chain head, then
+    // walk the chains, so the cache misses of a group overlap. Calls
+    // fn(i, value) for every live copy of key_of(i), i in [0, count), newest
+    // first and including shadowed duplicates
+    template<typename KeyOf, typename F>
+    void probe_batch(size_t count, KeyOf&& key_of, F&& fn) const {
+        size_t indices[PROBE_BATCH];
+        Node* heads[PROBE_BATCH];
+
+        for (size_t first = 0; first < count; first += PROBE_BATCH) {
+            size_t batch = std::min(PROBE_BATCH, count - first);
+            for (size_t i = 0; i < batch; i++) {
+                indices[i] = get_bucket_index(key_of(first + i));
+                prefetch(&buckets[indices[i]]);
+            }
+            for (size_t i = 0; i < batch; i++) {
+                heads[i] = buckets[indices[i]].load(std::memory_order_acquire);
+                prefetch(heads[i]);
+            }
+            for (size_t i = 0; i < batch; i++) {
+                const K& key = key_of(first + i);
+                for (Node* current = heads[i]; current != nullptr;
+                     current = current->next.load(std::memory_order_acquire)) {
+                    if (!current->deleted.load(std::memory_order_acquire) && current->key == key &&
+                        ready(current)) {
+                        fn(first + i, static_cast<const V&>(current->value));
+                    }
+                }
+            }
+        }
+    }
+
+#ifdef LOCKFREE_HASHMAP_HAS_COROUTINES
+    // get() as a coroutine that suspends after prefetching the bucket slot and
+    // each node it is about to read (see coro_lookup.hpp). The key is copied
+    // into the frame; the map must outlive the task. Counted and probed as a
+    // GET, but never latency-sampled: its wall time includes the time spent
+    // suspended while other lookups ran
+    LookupTask<V> get_async(K key) const {
+        size_t index = get_bucket_index(key);
+        const std::atomic<Node*>* slot = &buckets[index];
+        LFHM_IF_INSTRUMENTED(uint64_t traversed = 0;)
+        co_await PrefetchAwaiter{slot};
+        Node* current = slot->load(std::memory_order_acquire);
+        while (current != nullptr) {
+            co_await PrefetchAwaiter{current};
+            LFHM_IF_INSTRUMENTED(traversed++;)
+            if (!current->deleted.load(std::memory_order_acquire) && current->key == key &&
+                ready(current)) {
+                LFHM_IF_PROBES(probe_long_chain(index, traversed);)
+                LFHM_COUNT(counters, Counter::GET_HITS, 1);
+                LFHM_COUNT(counters, Counter::GET_NODES_TRAVERSED, traversed);
+                co_return std::optional<V>(current->value);
+            }
+            current = current->next.load(std::memory_order_acquire);
+        }
+        LFHM_IF_PROBES(probe_long_chain(index, traversed);)
+        LFHM_COUNT(counters, Counter::GET_MISSES, 1);
+        LFHM_COUNT(counters, Counter::GET_NODES_TRAVERSED, traversed);
+        co_return std::nullopt;
+    }
+#endif
+
+    // Return key's value, calling factory() to create it if the key is absent.
+    // Concurrent callers missing on the same key share one factory() call: the
+    // first links a placeholder node and computes, the rest wait on the node's
+    // state word (atomic::wait where available) and return its value. get()
+    // misses and remove() finds nothing until the value is ready. If factory()
+    // throws, the exception reaches its caller and one of the waiters computes
+    // instead
+    template<typename F>
+    V get_or_compute(const K& key, F&& factory) {
+        size_t index = get_bucket_index(key);
+        Node* placeholder = nullptr;
+
+        while (true) {
+            Node* head = buckets[index].load(std::memory_order_acquire);
+            Node* found = find_live(head, key);
+            if (found != nullptr) {
+                if (wait_computed(found) == NODE_FAILED) {
+                    continue; // The failed node is deleted; look again
+                }
+                delete placeholder;
+                return found->value;
+            }
+
+            if (placeholder == nullptr) {
+                placeholder = new Node(key, V());
+                placeholder->state.store(NODE_COMPUTING, std::memory_order_relaxed);
+            }
+            placeholder->next.store(head, std::memory_order_relaxed);
+            // Fails if anything was prepended since the scan, which may be our key
+            if (buckets[index].compare_exchange_weak(
+                    head, placeholder,
+                    std::memory_order_release,
+                    std::memory_order_acquire)) {
+                break;
+            }
+        }
+
+        try {
+            placeholder->value = factory();
+        } catch (...) {
+            placeholder->deleted.store(true, std::memory_order_release);
+            finish_computing(placeholder, NODE_FAILED);
+            throw;
+        }
+        // Publish before the node becomes ready: removes only delete ready
+        // nodes, so a REMOVE of this value always follows its INSERT
+        if (mutation_feed != nullptr) {
+            mutation_feed->publish(MutationFeed<K, V>::Type::INSERT, key, &placeholder->value);
+        }
+        finish_computing(placeholder, NODE_READY);
+        LFHM_IF_MVCC(stamp(placeholder->inserted_at);)
+        return placeholder->value;
+    }
+
+    // Fold value into key's entry: insert it if the key is absent, otherwise
+    // replace the stored value v with combine(v, value) by a CAS loop on the
+    // value itself. Like get_or_compute(), a key is only linked when a scan
+    // finds no live copy, so concurrent merges of one key share a node. Meant
+    // for aggregation phases: a get() of a key that is being merged races with
+    // the in-place update
+    template<typename Combine>
+    void merge(const K& key, const V& value, Combine&& combine) {
+        static_assert(std::is_trivially_copyable<V>::value && sizeof(V) <= 8 &&
+                          (sizeof(V) & (sizeof(V) - 1)) == 0 && alignof(V) == sizeof(V),
+                      "merge() needs a trivially copyable V of 1, 2, 4 or 8 bytes aligned to its size");
+        size_t index = get_bucket_index(key);
+        Node* fresh = nullptr;
+
+        while (true) {
+            Node* head = buckets[index].load(std::memory_order_acquire);
+            Node* found = find_live(head, key);
+            if (found != nullptr) {
+                if (wait_computed(found) == NODE_FAILED) {
+                    continue;
+                }
+                delete fresh;
+                V expected;
+                V desired;
+                __atomic_load(&found->value, &expected, __ATOMIC_RELAXED);
+                do {
+                    desired = combine(static_cast<const V&>(expected), value);
+                } while (!__atomic_compare_exchange(&found->value, &expected, &desired, true,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+                if (mutation_feed != nullptr) {
+                    mutation_feed->publish(MutationFeed<K, V>::Type::INSERT, key, &desired);
+                }
+                return;
+            }
+
+            if (fresh == nullptr) {
+                fresh = new Node(key, value);
+            }
+            fresh->next.store(head, std::memory_order_relaxed);
+            if (buckets[index].compare_exchange_weak(
+                    head, fresh,
+                    std::memory_order_release,
+                    std::memory_order_acquire)) {
+                LFHM_IF_MVCC(stamp(fresh->inserted_at);)
+                if (mutation_feed != nullptr) {
+                    mutation_feed->publish(MutationFeed<K, V>::Type::INSERT, key, &value);
+                }
+                return;
+            }
+        }
+    }
+
+    // Bucket/chain statistics gathered by stats()
+    // Counts cover only the buckets that were walked; scale by
+    // bucket_count / buckets_sampled to estimate whole-map totals
+    struct Stats {
+        static constexpr size_t HISTOGRAM_BINS = 16;
+
+        size_t bucket_count = 0;
+        size_t buckets_sampled = 0;
+        size_t empty_buckets = 0;
+        size_t live_entries = 0;        // Nodes get() can return
+        size_t tombstones = 0;          // Logically deleted nodes still in a chain
+        size_t computing = 0;           // get_or_compute() placeholders not yet filled in
+        size_t shadowed_duplicates = 0; // Live nodes hidden behind a newer node with the same key
+        size_t max_chain_length = 0;
+        double mean_chain_length = 0.0;
+
+        // Whole-map estimate: bucket array plus nodes extrapolated from the sample
+        // (does not include heap memory owned by K or V)
+        size_t estimated_memory_bytes = 0;
+
+        // Bin 0 counts empty chains, bin i counts chains of length [2^(i-1), 2^i)
+        // The last bin also holds every longer chain
+        size_t chain_length_histogram[HISTOGRAM_BINS] = {};
+
+        static size_t histogram_bin(size_t chain_length) {
+            size_t bin = 0;
+            while (chain_length != 0 && bin < HISTOGRAM_BINS - 1) {
+                chain_length >>= 1;
+                bin++;
+            }
+            return bin;
+        }
+    };
+
+    // Walk every sample_stride-th bucket and report chain statistics
+    // sample_stride == 1 scans the whole map; larger strides are cheap enough to
+    // poll periodically. Safe to call concurrently with insert/get/remove since
+    // nodes are never freed while the map is alive (results are weakly consistent)
+    Stats stats(size_t sample_stride = 1) const {
+        if (sample_stride == 0) {
+            throw std::invalid_argument("sample_stride must be at least 1");
+        }
+
+        Stats result;
+        result.bucket_count = capacity;
+
+        size_t total_chain_length = 0;
+        std::vector<const K*> live_keys;
+
+        for (size_t index = 0; index < capacity; index += sample_stride) {
+            size_t chain_length = 0;
+            live_keys.clear();
+
+            Node* current = buckets[index].load(std::memory_order_acquire);
+            while (current != nullptr) {
+                chain_length++;
+
+                if (current->deleted.load(std::memory_order_acquire)) {
+                    result.tombstones++;
+                } else if (!ready(current)) {
+                    result.computing++;
+                } else {
+                    bool shadowed = false;
+                    for (const K* key : live_keys) {
+                        if (*key == current->key) {
+                            shadowed = true;
+                            break;
+                        }
+                    }
+
+                    if (shadowed) {
+                        result.shadowed_duplicates++;
+                    } else {
+                        result.live_entries++;
+                        live_keys.push_back(&current->key);
+                    }
+                }
+                current = current->next.load(std::memory_order_acquire);
+            }
+
+            result.buckets_sampled++;
+            if (chain_length == 0) {
+                result.empty_buckets++;
+            }
+            result.max_chain_length = std::max(result.max_chain_length, chain_length);
+            result.chain_length_histogram[Stats::histogram_bin(chain_length)]++;
+            total_chain_length += chain_length;
+        }
+
+        result.estimated_memory_bytes = sizeof(*this) + capacity * sizeof(std::atomic<Node*>);
+        if (result.buckets_sampled != 0) {
+            result.mean_chain_length =
+                static_cast<double>(total_chain_length) / result.buckets_sampled;
+            result.estimated_memory_bytes += static_cast<size_t>(
+                result.mean_chain_length * static_cast<double>(capacity)) * sizeof(Node);
+        }
+        return result;
+    }
+
+    // Aggregated operation counters across all threads
+    // All fields read zero unless built with LOCKFREE_HASHMAP_ENABLE_COUNTERS
+    struct OpCounters {
+        uint64_t gets = 0;
+        uint64_t get_hits = 0;
+        uint64_t get_misses = 0;
+        uint64_t get_nodes_traversed = 0;
+        uint64_t inserts = 0;
+        uint64_t insert_cas_attempts = 0;
+        uint64_t insert_cas_failures = 0;
+        uint64_t removes = 0;
+        uint64_t remove_hits = 0;
+        uint64_t remove_misses = 0;
+        uint64_t remove_nodes_traversed = 0;
+        uint64_t remove_cas_attempts = 0;
+        uint64_t remove_cas_failures = 0;
+    };
+
+#ifdef LOCKFREE_HASHMAP_ENABLE_COUNTERS
+    static constexpr bool counters_enabled = true;
+#else
+    static constexpr bool counters_enabled = false;
+#endif
+
+    OpCounters op_counters() const {
+        OpCounters result;
+#ifdef LOCKFREE_HASHMAP_ENABLE_COUNTERS
+        auto totals = counters.sum();
+        auto total = [&totals](Counter counter) { return totals[static_cast<size_t>(counter)]; };
+
+        result.get_hits = total(Counter::GET_HITS);
+        result.get_misses = total(Counter::GET_MISSES);
+        result.gets = result.get_hits + result.get_misses;
+        result.get_nodes_traversed = total(Counter::GET_NODES_TRAVERSED);
+        result.inserts = total(Counter::INSERTS);
+        result.insert_cas_attempts = total(Counter::INSERT_CAS_ATTEMPTS);
+        result.insert_cas_failures = total(Counter::INSERT_CAS_FAILURES);
+        result.remove_hits = total(Counter::REMOVE_HITS);
+        result.remove_misses = total(Counter::REMOVE_MISSES);
+        result.removes = result.remove_hits + result.remove_misses;
+        result.remove_nodes_traversed = total(Counter::REMOVE_NODES_TRAVERSED);
+        result.remove_cas_attempts = total(Counter::REMOVE_CAS_ATTEMPTS);
+        result.remove_cas_failures = total(Counter::REMOVE_CAS_FAILURES);
+#endif
+        return result;
+    }
+
+    // Visit every live entry as fn(key, value), newest value per key
+    // Weakly consistent under concurrent writers: each bucket is read once
+    template<typename F>
+    void for_each(F&& fn) const {
+        for_each_in_buckets(0, capacity, std::forward<F>(fn));
+    }
+
+    // for_each() restricted to buckets [first, last), for splitting scans
+    // across threads
+    template<typename F>
+    void for_each_in_buckets(size_t first, size_t last, F&& fn) const {
+        std::vector<const K*> seen;
+        for (size_t index = first; index < last && index < capacity; index++) {
+            for_each_visible(index, seen, [&fn](const Node* node) {
+                fn(node->key, node->value);
+            });
+        }
+    }
+
+    size_t bucket_count() const {
+        return capacity;
+    }
+
+#ifdef LOCKFREE_HASHMAP_ENABLE_MVCC
+    // Consistent read-only view of the map as of the moment snapshot() was
+    // called, while writers carry on. Taking one is O(1) and copies nothing;
+    // the view reads the shared nodes and filters them by version stamp, so it
+    // stays valid for as long as the map lives. Reads may briefly wait for a
+    // writer that has linked a node but not stamped it yet
+    class Snapshot {
+    private:
+        const LockFreeHashMap* map;
+        uint64_t snapshot_version;
+
+    public:
+        Snapshot(const LockFreeHashMap* source, uint64_t version)
+            : map(source), snapshot_version(version) {}
+
+        bool get(const K& key, V& value) const {
+            size_t index = map->get_bucket_index(key);
+            for (Node* current = map->buckets[index].load(std::memory_order_acquire);
+                 current != nullptr;
+                 current = current->next.load(std::memory_order_acquire)) {
+                if (current->key == key && visible_at(current, snapshot_version)) {
+                    value = current->value;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Visit every entry of the view as fn(key, value), newest value per key
+        template<typename F>
+        void for_each(F&& fn) const {
+            for_each_in_buckets(0, map->capacity, std::forward<F>(fn));
+        }
+
+        template<typename F>
+        void for_each_in_buckets(size_t first, size_t last, F&& fn) const {
+            std::vector<const K*> seen;
+            for (size_t index = first; index < last && index < map->capacity; index++) {
+                map->for_each_visible_at(index, snapshot_version, seen, [&fn](const Node* node) {
+                    fn(node->key, node->value);
+                });
+            }
+        }
+
+        size_t bucket_count() const {
+            return map->capacity;
+        }
+
+        uint64_t version() const {
+            return snapshot_version;
+        }
+    };
+
+    Snapshot snapshot() const {
+        uint64_t version = version_clock.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return Snapshot(this, version);
+    }
+#endif
+
+    // Collect the live entries in parallel and index them with a minimal
+    // perfect hash (see perfect_hash.hpp)
+    template<typename Hash = std::hash<K>>
+    PerfectHashMap<K, V, Hash> build_perfect_hash(size_t threads = 0, double gamma = 1.0) const {
+        if (threads == 0) {
+            threads = default_parallelism();
+        }
+        std::vector<std::vector<std::pair<K, V>>> parts(threads);
+        run_parallel(threads, [&](size_t worker) {
+            for_each_in_buckets(capacity * worker / threads, capacity * (worker + 1) / threads,
+                                [&](const K& key, const V& value) {
+                                    parts[worker].emplace_back(key, value);
+                                });
+        });
+
+        std::vector<std::pair<K, V>> entries;
+        for (auto& part : parts) {
+            entries.insert(entries.end(), std::make_move_iterator(part.begin()),
+                           std::make_move_iterator(part.end()));
+        }
+        return PerfectHashMap<K, V, Hash>::build(std::move(entries), threads, gamma);
+    }
+
+    // Copy the live entries into an immutable flat table that can be written
+    // to a file and mmapped by other processes (see frozen_hashmap.hpp)
+    // Requires padding-free K and trivially copyable V. Runs on the calling
+    // thread: the table is filled by one linear-probing pass
+    FrozenHashMap<K, V> freeze() const {
+        return FrozenHashMap<K, V>::build(*this);
+    }
+
+    // Write the live entries to a binary snapshot (see snapshot.hpp)
+    // Bucket ranges are serialized and written by `threads` workers in parallel
+    // (0 = one per core) while the map stays fully usable, so the result is
+    // weakly consistent. The file is built as path + ".tmp", synced, then
+    // renamed over path and the directory synced, so the new snapshot is
+    // durable on return. Throws std::runtime_error on I/O failure and
+    // std::length_error for a std::string key or value of 4 GiB or more; path
+    // is left untouched either way
+    void save(const std::string& path, size_t threads = 0) const {
+        static_assert(SnapshotSerializer<K>::available && SnapshotSerializer<V>::available,
+                      "save() needs a SnapshotSerializer specialisation for K and V");
+
+        if (threads == 0) {
+            threads = default_parallelism();
+        }
+        threads = std::max<size_t>(1, std::min(threads, capacity));
+
+        std::string tmp_path = path + ".tmp";
+        SnapshotFile file(tmp_path, O_WRONLY | O_CREAT | O_TRUNC);
+
+        std::atomic<uint64_t> next_offset{sizeof(SnapshotHeader)};
+        std::vector<std::vector<SnapshotChunk>> chunks(threads);
+
+        run_parallel(threads, [&](size_t worker) {
+            size_t first = capacity * worker / threads;
+            size_t last = capacity * (worker + 1) / threads;
+
+            std::string buffer;
+            buffer.reserve(SNAPSHOT_CHUNK_BYTES * 2);
+            uint64_t records = 0;
+            std::vector<const K*> seen;
+
+            auto flush = [&]() {
+                if (records == 0) {
+                    return;
+                }
+                uint64_t offset = next_offset.fetch_add(buffer.size(), std::memory_order_relaxed);
+                file.write_at(buffer.data(), buffer.size(), offset);
+                chunks[worker].push_back({offset, buffer.size(), records,
+                                          snapshot_checksum(buffer.data(), buffer.size())});
+                buffer.clear();
+                records = 0;
+            };
+
+            for (size_t index = first; index < last; index++) {
+                for_each_visible(index, seen, [&](const Node* node) {
+                    SnapshotSerializer<K>::write(buffer, node->key);
+                    SnapshotSerializer<V>::write(buffer, node->value);
+                    records++;
+                    if (buffer.size() >= SNAPSHOT_CHUNK_BYTES) {
+                        flush();
+                    }
+                });
+            }
+            flush();
+        });
+
+        std::vector<SnapshotChunk> table;
+        uint64_t record_count = 0;
+        for (const auto& worker_chunks : chunks) {
+            for (const auto& chunk : worker_chunks) {
+                table.push_back(chunk);
+                record_count += chunk.record_count;
+            }
+        }
+
+        uint64_t table_offset = next_offset.load(std::memory_order_relaxed);
+        size_t table_bytes = table.size() * sizeof(SnapshotChunk);
+        uint64_t table_checksum = snapshot_checksum(table.data(), table_bytes);
+        file.write_at(table.data(), table_bytes, table_offset);
+        file.write_at(&table_checksum, sizeof(table_checksum), table_offset + table_bytes);
+
+        SnapshotHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, SnapshotHeader::MAGIC, sizeof(header.magic));
+        header.version = SnapshotHeader::VERSION;
+        header.byte_order_mark = SnapshotHeader::BYTE_ORDER_MARK;
+        header.key_size = SnapshotSerializer<K>::fixed_size;
+        header.value_size = SnapshotSerializer<V>::fixed_size;
+        header.bucket_count = capacity;
+        header.record_count = record_count;
+        header.chunk_count = table.size();
+        header.chunk_table_offset = table_offset;
+        header.checksum = snapshot_checksum(&header, offsetof(SnapshotHeader, checksum));
+        file.write_at(&header, sizeof(header), 0);
+
+        file.sync();
+        file.close();
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("cannot rename " + tmp_path + " to " + path);
+        }
+        sync_parent_directory(path);
+    }
+
+    // Bucket count of the map a snapshot was saved from, for pre-sizing the
+    // map that will load it
+    static size_t snapshot_bucket_count(const std::string& path) {
+        SnapshotFile file(path, O_RDONLY);
+        return static_cast<size_t>(read_snapshot_header(file, path).bucket_count);
+    }
+
+    // Insert every entry from a snapshot written by save()
+    // Chunks are read, verified and inserted by `threads` workers in parallel
+    // (0 = one per core); chunks come from disjoint bucket ranges, so workers
+    // rarely contend on a bucket head when the map has the snapshot's bucket
+    // count. Throws std::runtime_error on a malformed or corrupt file, in which
+    // case entries from chunks decoded before the error remain inserted
+    void load(const std::string& path, size_t threads = 0) {
+        static_assert(SnapshotSerializer<K>::available && SnapshotSerializer<V>::available,
+                      "load() needs a SnapshotSerializer specialisation for K and V");
+
+        SnapshotFile file(path, O_RDONLY);
+        SnapshotHeader header = read_snapshot_header(file, path);
+
+        uint64_t file_size = file.size();
+        uint64_t table_bytes = header.chunk_count * sizeof(SnapshotChunk);
+        if (header.chunk_count > file_size / sizeof(SnapshotChunk) ||
+            header.chunk_table_offset < sizeof(SnapshotHeader) ||
+            header.chunk_table_offset + table_bytes + sizeof(uint64_t) > file_size) {
+            throw std::runtime_error("snapshot " + path + " is truncated");
+        }
+
+        std::vector<SnapshotChunk> table(header.chunk_count);
+        uint64_t table_checksum;
+        file.read_at(table.data(), table_bytes, header.chunk_table_offset);
+        file.read_at(&table_checksum, sizeof(table_checksum), header.chunk_table_offset + table_bytes);
+        if (table_checksum != snapshot_checksum(table.data(), table_bytes)) {
+            throw std::runtime_error("snapshot " + path + " has a corrupt chunk table");
+        }
+
+        uint64_t record_count = 0;
+        for (const auto& chunk : table) {
+            if (chunk.offset < sizeof(SnapshotHeader) || chunk.length > header.chunk_table_offset ||
+                chunk.offset > header.chunk_table_offset - chunk.length) {
+                throw std::runtime_error("snapshot " + path + " has a chunk out of bounds");
+            }
+            record_count += chunk.record_count;
+        }
+        if (record_count != header.record_count) {
+            throw std::runtime_error("snapshot " + path + " record count mismatch");
+        }
+
+        if (threads == 0) {
+            threads = default_parallelism();
+        }
+        threads = std::max<size_t>(1, std::min<size_t>(threads, table.size()));
+
+        std::atomic<size_t> next_chunk{0};
+        run_parallel(threads, [&](size_t) {
+            std::string buffer;
+            std::vector<std::pair<K, V>> loaded;
+            K key{};
+            V value{};
+
+            for (size_t i = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                 i < table.size();
+                 i = next_chunk.fetch_add(1, std::memory_order_relaxed)) {
+                const SnapshotChunk& chunk = table[i];
+                buffer.resize(chunk.length);
+                file.read_at(&buffer[0], chunk.length, chunk.offset);
+                if (snapshot_checksum(buffer.data(), buffer.size()) != chunk.checksum) {
+                    throw std::runtime_error("snapshot " + path + " has a corrupt chunk");
+                }
+
+                const char* in = buffer.data();
+                const char* end = in + buffer.size();
+                loaded.clear();
+                for (uint64_t r = 0; r < chunk.record_count; r++) {
+                    if (!SnapshotSerializer<K>::read(in, end, key) ||
+                        !SnapshotSerializer<V>::read(in, end, value)) {
+                        throw std::runtime_error("snapshot " + path + " has a malformed record");
+                    }
+                    insert_impl(key, value, false);
+                    if (mutation_feed != nullptr) {
+                        loaded.emplace_back(key, value);
+                    }
+                }
+                if (in != end) {
+                    throw std::runtime_error("snapshot " + path + " has trailing chunk bytes");
+                }
+                // One sequence claim for the whole chunk
+                if (mutation_feed != nullptr) {
+                    mutation_feed->publish_batch(MutationFeed<K, V>::Type::INSERT,
+                                                 loaded.begin(), loaded.end());
+                }
+            }
+        });
+    }
+
+#ifdef LOCKFREE_HASHMAP_ENABLE_LATENCY_SAMPLING
+    static constexpr bool latency_sampling_enabled = true;
+#else
+    static constexpr bool latency_sampling_enabled = false;
+#endif
+
+    // Time one in every `interval` operations per thread; 0 stops sampling
+    // No effect unless built with LOCKFREE_HASHMAP_ENABLE_LATENCY_SAMPLING
+    void set_latency_sample_interval(uint32_t interval) {
+#ifdef LOCKFREE_HASHMAP_ENABLE_LATENCY_SAMPLING
+        latency_sampler.set_interval(interval);
+#else
+        (void)interval;
+#endif
+    }
+
+    // Sampled latencies of one operation type merged across threads
+    // Empty unless built with LOCKFREE_HASHMAP_ENABLE_LATENCY_SAMPLING
+    LatencySnapshot latency(LatencyOp op) const {
+#ifdef LOCKFREE_HASHMAP_ENABLE_LATENCY_SAMPLING
+        return latency_sampler.snapshot(static_cast<size_t>(op));
+#else
+        (void)op;
+        return LatencySnapshot();
+#endif
+    }
+
     size_t size() const {
         return capacity;
     }
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Histogram with power-of-two bins for non-negative integer samples
+// (latencies in nanoseconds, chain lengths, ...). Bin 0 holds zero, bin i holds
+// values in [2^(i-1), 2^i). Recording is a couple of relaxed fetch_adds, so many
+// threads may record into the same instance; percentiles are upper bin bounds
+class LogHistogram {
+public:
+    static constexpr size_t BINS = 64;
+
+private:
+    std::atomic<uint64_t> bins[BINS];
+    std::atomic<uint64_t> total_count;
+    std::atomic<uint64_t> total_sum;
+
+public:
+    LogHistogram() : total_count(0), total_sum(0) {
+        for (auto& bin : bins) {
+            bin.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    LogHistogram(const LogHistogram& other) : LogHistogram() {
+        merge(other);
+    }
+
+    LogHistogram& operator=(const LogHistogram& other) {
+        if (this != &other) {
+            reset();
+            merge(other);
+        }
+        return *this;
+    }
+
+    static size_t bin_for(uint64_t value) {
+        if (value == 0) {
+            return 0;
+        }
+#if defined(__GNUC__) || defined(__clang__)
+        size_t bin = 64 - static_cast<size_t>(__builtin_clzll(value));
+#else
+        size_t bin = 0;
+        while (value != 0) {
+            value >>= 1;
+            bin++;
+        }
+#endif
+        return bin < BINS ? bin : BINS - 1;
+    }
+
+    // Largest value that lands in the given bin
+    static uint64_t bin_upper_bound(size_t bin) {
+        if (bin == 0) {
+            return 0;
+        }
+        if (bin >= BINS - 1) {
+            return UINT64_MAX;
+        }
+        return (uint64_t(1) << bin) - 1;
+    }
+
+    void record(uint64_t value) {
+        bins[bin_for(value)].fetch_add(1, std::memory_order_relaxed);
+        total_count.fetch_add(1, std::memory_order_relaxed);
+        total_sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Same as record() for an instance only one thread ever writes: plain
+    // relaxed load + store instead of locked read-modify-writes
+    void record_owned(uint64_t value) {
+        auto bump = [](std::atomic<uint64_t>& counter, uint64_t n) {
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        };
+        bump(bins[bin_for(value)], 1);
+        bump(total_count, 1);
+        bump(total_sum, value);
+    }
+
+    // Add another histogram's samples into this one
+    void merge(const LogHistogram& other) {
+        for (size_t i = 0; i < BINS; i++) {
+            bins[i].fetch_add(other.bin_count(i), std::memory_order_relaxed);
+        }
+        total_count.fetch_add(other.count(), std::memory_order_relaxed);
+        total_sum.fetch_add(other.sum(), std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (auto& bin : bins) {
+            bin.store(0, std::memory_order_relaxed);
+        }
+        total_count.store(0, std::memory_order_relaxed);
+        total_sum.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t bin_count(size_t bin) const {
+        return bins[bin].load(std::memory_order_relaxed);
+    }
+
+    uint64_t count() const {
+        return total_count.load(std::memory_order_relaxed);
+    }
+
+    uint64_t sum() const {
+        return total_sum.load(std::memory_order_relaxed);
+    }
+
+    // Upper bound of the bin holding the q-th quantile (q in [0, 1]); 0 when empty
+    uint64_t percentile(double q) const {
+        uint64_t samples = 0;
+        for (size_t i = 0; i < BINS; i++) {
+            samples += bin_count(i);
+        }
+        if (samples == 0) {
+            return 0;
+        }
+        q = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(samples - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BINS; i++) {
+            seen += bin_count(i);
+            if (seen >= rank) {
+                return bin_upper_bound(i);
+            }
+        }
+        return bin_upper_bound(BINS - 1);
+    }
+};
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hazard_pointer.hpp"
+#include "latency_sampler.hpp"
+#include "lockfree_hashmap.hpp"
+#include "log_histogram.hpp"
+
+// Renders map and reclaimer metrics in the Prometheus text exposition format
+// Samples are grouped per metric family, so several maps can be exported into
+// one writer (distinguished by their "map" label) and still produce valid output
+class PrometheusWriter {
+private:
+    struct Family {
+        std::string name;
+        std::string help;
+        std::string type;
+        std::vector<std::string> samples;
+    };
+
+    std::vector<Family> families;
+
+    Family& family(const std::string& name, const std::string& help, const std::string& type) {
+        for (auto& f : families) {
+            if (f.name == name) {
+                if (f.type != type) {
+                    throw std::invalid_argument("metric " + name + " registered with two types");
+                }
+                return f;
+            }
+        }
+        families.push_back({name, help, type, {}});
+        return families.back();
+    }
+
+    static std::string format_number(double value) {
+        if (value == std::numeric_limits<double>::infinity()) {
+            return "+Inf";
+        }
+        std::ostringstream out;
+        out << std::setprecision(12) << value;
+        return out.str();
+    }
+
+    static std::string escape_label(const std::string& value) {
+        std::string escaped;
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+                escaped += c;
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    static std::string format_labels(const Labels& labels) {
+        if (labels.empty()) {
+            return "";
+        }
+        std::string out = "{";
+        for (size_t i = 0; i < labels.size(); i++) {
+            if (i != 0) {
+                out += ",";
+            }
+            out += labels[i].first + "=\"" + escape_label(labels[i].second) + "\"";
+        }
+        return out + "}";
+    }
+
+    void gauge(const std::string& name, const std::string& help,
+               const Labels& labels, double value) {
+        family(name, help, "gauge").samples.push_back(
+            name + format_labels(labels) + " " + format_number(value));
+    }
+
+    void counter(const std::string& name, const std::string& help,
+                 const Labels& labels, uint64_t value) {
+        family(name, help, "counter").samples.push_back(
+            name + format_labels(labels) + " " + std::to_string(value));
+    }
+
+    // bucket_counts are per bucket (not cumulative); a +Inf bucket is appended
+    // when the last upper bound is finite
+    void histogram(const std::string& name, const std::string& help, const Labels& labels,
+                   const std::vector<double>& upper_bounds,
+                   const std::vector<uint64_t>& bucket_counts,
+                   double sum) {
+        if (upper_bounds.size() != bucket_counts.size()) {
+            throw std::invalid_argument("histogram bounds and counts differ in length");
+        }
+
+        Family& f = family(name, help, "histogram");
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < upper_bounds.size(); i++) {
+            cumulative += bucket_counts[i];
+            Labels bucket_labels = labels;
+            bucket_labels.emplace_back("le", format_number(upper_bounds[i]));
+            f.samples.push_back(name + "_bucket" + format_labels(bucket_labels) +
+                                " " + std::to_string(cumulative));
+        }
+        if (upper_bounds.empty() ||
+            upper_bounds.back() != std::numeric_limits<double>::infinity()) {
+            Labels bucket_labels = labels;
+            bucket_labels.emplace_back("le", "+Inf");
+            f.samples.push_back(name + "_bucket" + format_labels(bucket_labels) +
+                                " " + std::to_string(cumulative));
+        }
+        f.samples.push_back(name + "_sum" + format_labels(labels) + " " + format_number(sum));
+        f.samples.push_back(name + "_count" + format_labels(labels) + " " +
+                            std::to_string(cumulative));
+    }
+
+    // Render a LogHistogram, trimming empty high bins; unit scales bin bounds and sum
+    void histogram(const std::string& name, const std::string& help, const Labels& labels,
+                   const LogHistogram& hist, double unit = 1.0) {
+        size_t last_used = 0;
+        for (size_t i = 0; i < LogHistogram::BINS; i++) {
+            if (hist.bin_count(i) != 0) {
+                last_used = i;
+            }
+        }
+
+        std::vector<double> bounds;
+        std::vector<uint64_t> counts;
+        for (size_t i = 0; i <= last_used; i++) {
+            bounds.push_back(static_cast<double>(LogHistogram::bin_upper_bound(i)) * unit);
+            counts.push_back(hist.bin_count(i));
+        }
+        bounds.push_back(std::numeric_limits<double>::infinity());
+        counts.push_back(0);
+
+        histogram(name, help, labels, bounds, counts, static_cast<double>(hist.sum()) * unit);
+    }
+
+    std::string str() const {
+        std::string out;
+        for (const auto& f : families) {
+            out += "# HELP " + f.name + " " + f.help + "\n";
+            out += "# TYPE " + f.name + " " + f.type + "\n";
+            for (const auto& sample : f.samples) {
+                out += sample + "\n";
+            }
+        }
+        return out;
+    }
+
+    // Write to path via a temporary file and rename, so a scraper never sees a
+    // partially written file
+    void write_file(const std::string& path) const {
+        std::string tmp_path = path + ".tmp";
+        std::string text = str();
+
+        FILE* file = std::fopen(tmp_path.c_str(), "w");
+        if (file == nullptr) {
+            throw std::runtime_error("cannot open " + tmp_path);
+        }
+        bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        ok = (std::fclose(file) == 0) && ok;
+        if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("cannot write " + path);
+        }
+    }
+
+    void clear() {
+        families.clear();
+    }
+};
+
+// Caller-recorded operation latency in nanoseconds, exported in seconds
+inline void export_latency_metrics(PrometheusWriter& writer, const std::string& map_name,
+                                   const std::string& op, const LogHistogram& latency_ns) {
+    writer.histogram("lockfree_hashmap_op_latency_seconds", "Operation latency",
+                     {{"map", map_name}, {"op", op}}, latency_ns, 1e-9);
+}
+
+// Latency sampled inside the map (ticks), exported in seconds
+inline void export_latency_metrics(PrometheusWriter& writer, const std::string& map_name,
+                                   const std::string& op, const LatencySnapshot& latency) {
+    writer.histogram("lockfree_hashmap_op_latency_seconds", "Operation latency",
+                     {{"map", map_name}, {"op", op}}, latency.ticks, latency.ns_per_tick * 1e-9);
+}
+
+// Gauges and histograms derived from map.stats(sample_stride), plus operation
+// counters and sampled latency when the map was built with them
+template<typename K, typename V>
+void export_map_metrics(PrometheusWriter& writer, const LockFreeHashMap<K, V>& map,
+                        const std::string& map_name, size_t sample_stride = 1) {
+    using Stats = typename LockFreeHashMap<K, V>::Stats;
+    const PrometheusWriter::Labels labels = {{"map", map_name}};
+
+    Stats stats = map.stats(sample_stride);
+    double scale = stats.buckets_sampled == 0
+        ? 0.0
+        : static_cast<double>(stats.bucket_count) / static_cast<double>(stats.buckets_sampled);
+
+    writer.gauge("lockfree_hashmap_entries", "Live entries (estimated when sampled)",
+                 labels, static_cast<double>(stats.live_entries) * scale);
+    writer.gauge("lockfree_hashmap_tombstones",
+                 "Logically deleted nodes still linked (estimated when sampled)",
+                 labels, static_cast<double>(stats.tombstones) * scale);
+    writer.gauge("lockfree_hashmap_shadowed_duplicates",
+                 "Live nodes hidden by a newer node with the same key (estimated when sampled)",
+                 labels, static_cast<double>(stats.shadowed_duplicates) * scale);
+    writer.gauge("lockfree_hashmap_buckets", "Bucket count", labels,
+                 static_cast<double>(stats.bucket_count));
+    writer.gauge("lockfree_hashmap_empty_buckets", "Empty buckets (estimated when sampled)",
+                 labels, static_cast<double>(stats.empty_buckets) * scale);
+    writer.gauge("lockfree_hashmap_memory_bytes", "Estimated bucket array and node memory",
+                 labels, static_cast<double>(stats.estimated_memory_bytes));
+    writer.gauge("lockfree_hashmap_max_chain_length", "Longest sampled chain", labels,
+                 static_cast<double>(stats.max_chain_length));
+
+    std::vector<double> bounds;
+    std::vector<uint64_t> counts;
+    for (size_t bin = 0; bin < Stats::HISTOGRAM_BINS; bin++) {
+        bounds.push_back(bin == Stats::HISTOGRAM_BINS - 1
+            ? std::numeric_limits<double>::infinity()
+            : static_cast<double>(LogHistogram::bin_upper_bound(bin)));
+        counts.push_back(stats.chain_length_histogram[bin]);
+    }
+    writer.histogram("lockfree_hashmap_chain_length", "Chain length per sampled bucket",
+                     labels, bounds, counts,
+                     stats.mean_chain_length * static_cast<double>(stats.buckets_sampled));
+
+    if (LockFreeHashMap<K, V>::counters_enabled) {
+        auto ops = map.op_counters();
+        auto with = [&labels](const char* op, const char* result) {
+            PrometheusWriter::Labels l = labels;
+            l.emplace_back("op", op);
+            if (result != nullptr) {
+                l.emplace_back("result", result);
+            }
+            return l;
+        };
+
+        const char* ops_name = "lockfree_hashmap_operations_total";
+        const char* ops_help = "Completed operations";
+        writer.counter(ops_name, ops_help, with("get", "hit"), ops.get_hits);
+        writer.counter(ops_name, ops_help, with("get", "miss"), ops.get_misses);
+        writer.counter(ops_name, ops_help, with("insert", "ok"), ops.inserts);
+        writer.counter(ops_name, ops_help, with("remove", "hit"), ops.remove_hits);
+        writer.counter(ops_name, ops_help, with("remove", "miss"), ops.remove_misses);
+
+        const char* cas_name = "lockfree_hashmap_cas_failures_total";
+        const char* cas_help = "Failed compare-and-swap attempts";
+        writer.counter(cas_name, cas_help, with("insert", nullptr), ops.insert_cas_failures);
+        writer.counter(cas_name, cas_help, with("remove", nullptr), ops.remove_cas_failures);
+
+        const char* nodes_name = "lockfree_hashmap_nodes_traversed_total";
+        const char* nodes_help = "Chain nodes visited by lookups";
+        writer.counter(nodes_name, nodes_help, with("get", nullptr), ops.get_nodes_traversed);
+        writer.counter(nodes_name, nodes_help, with("remove", nullptr), ops.remove_nodes_traversed);
+    }
+
+    if (LockFreeHashMap<K, V>::latency_sampling_enabled) {
+        using LatencyOp = typename LockFreeHashMap<K, V>::LatencyOp;
+        export_latency_metrics(writer, map_name, "get", map.latency(LatencyOp::GET));
+        export_latency_metrics(writer, map_name, "insert", map.latency(LatencyOp::INSERT));
+        export_latency_metrics(writer, map_name, "remove", map.latency(LatencyOp::REMOVE));
+    }
+}
+
+// Unreclaimed-node gauge and reclaim counters; needs LOCKFREE_HASHMAP_ENABLE_COUNTERS
+// (without it every value reads zero)
+template<typename T>
+void export_reclaimer_metrics(PrometheusWriter& writer, const HazardPointerManager<T>& manager,
+                              const std::string& reclaimer_name) {
+    const PrometheusWriter::Labels labels = {{"reclaimer", reclaimer_name}};
+    auto counters = manager.reclaim_counters();
+
+    // The per-thread counters are summed without a snapshot, so a free can be
+    // seen before its retire; clamp instead of wrapping around
+    uint64_t unreclaimed = counters.retires > counters.reclaim_freed
+        ? counters.retires - counters.reclaim_freed
+        : 0;
+    writer.gauge("hazard_pointer_unreclaimed_nodes", "Retired nodes not yet freed", labels,
+                 static_cast<double>(unreclaimed));
+    writer.counter("hazard_pointer_retired_total", "Nodes retired", labels, counters.retires);
+    writer.counter("hazard_pointer_reclaim_passes_total", "Reclaim scans", labels,
+                   counters.reclaim_passes);
+    writer.counter("hazard_pointer_freed_total", "Nodes freed by reclaim scans", labels,
+                   counters.reclaim_freed);
+}
+
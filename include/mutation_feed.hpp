@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+// Bounded multi-producer/multi-consumer ring of map mutations (change data
+// capture). Attach one to a map with LockFreeHashMap::set_mutation_feed() and
+// every successful insert()/remove() publishes a record from the mutating
+// thread itself, right after the map update, so callers need no second queue.
+//
+// A record's sequence is its position in the ring, and consumers observe
+// sequences in strictly increasing order. Producers do not claim positions
+// one at a time from the shared tail: keys hash to LANES lanes, and a lane
+// takes block_size positions from the tail with one fetch_add and hands them
+// out to its producers by CAS on the lane's own counter. Per-slot turn
+// counters (Vyukov-style) hand each slot from its producer to a consumer and
+// back.
+//
+// Lane counters only grow and a new block always lies past every earlier
+// one, so mutations of one key ordered by happens-before (same thread, or
+// synchronised threads) get increasing sequences. Mutations of different keys
+// may appear out of that order, and concurrent mutations of the same key in
+// either order; consumers that need the converged value should re-read the
+// map. block_size 1 claims every record from the tail, restoring one order
+// across all keys.
+//
+// Positions a lane cannot use are filled with padding that consumers skip, so
+// sequences can have gaps: when two producers refill a lane at once, and when
+// a consumer finds the next position held back by an idle lane's unused
+// reservation. The consumer pads that reservation itself, so a quiet lane
+// never stalls the feed.
+//
+// The ring is bounded: when consumers fall a full ring behind, producers
+// wait for space inside insert()/remove(), which then block until a
+// consumer catches up
+template<typename K, typename V>
+class MutationFeed {
+public:
+    enum class Type : uint8_t {
+        INSERT,
+        REMOVE
+    };
+
+    struct Mutation {
+        uint64_t sequence;
+        Type type;
+        K key;
+        V value; // Default-constructed for REMOVE
+    };
+
+private:
+    static constexpr size_t LANES = 64;
+
+    struct Slot {
+        // == position: free for the producer of that position
+        // == position + 1: holds the record for the consumer of that position
+        std::atomic<uint64_t> turn;
+        bool padding = false; // Filler for an unused position; consumers skip it
+        Mutation mutation;
+    };
+
+    // Next unused position of the lane's block, or a multiple of block_size
+    // when the block is used up. Only ever grows
+    struct alignas(64) Lane {
+        std::atomic<uint64_t> next{0};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t capacity;
+    uint64_t mask;
+    uint64_t block_size;
+    std::unique_ptr<Lane[]> lanes;
+    std::hash<K> hasher;
+
+    alignas(64) std::atomic<uint64_t> tail{0}; // Next position to claim
+    alignas(64) std::atomic<uint64_t> head{0}; // Next position to consume
+
+    Slot& slot_at(uint64_t position) {
+        return slots[position & mask];
+    }
+
+    Lane& lane_of(const K& key) {
+        uint64_t h = hasher(key);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return lanes[h % LANES];
+    }
+
+    uint64_t block_end(uint64_t position) const {
+        return (position / block_size + 1) * block_size;
+    }
+
+    void wait_free(Slot& slot, uint64_t position) {
+        while (slot.turn.load(std::memory_order_acquire) != position) {
+            std::this_thread::yield(); // Ring full: a consumer still owns the slot
+        }
+    }
+
+    void write(uint64_t position, Type type, const K& key, const V* value) {
+        Slot& slot = slot_at(position);
+        wait_free(slot, position);
+        slot.padding = false;
+        slot.mutation.sequence = position;
+        slot.mutation.type = type;
+        slot.mutation.key = key;
+        slot.mutation.value = value != nullptr ? *value : V{};
+        slot.turn.store(position + 1, std::memory_order_release);
+    }
+
+    void pad(uint64_t first, uint64_t last) {
+        for (uint64_t position = first; position < last; position++) {
+            Slot& slot = slot_at(position);
+            wait_free(slot, position);
+            slot.padding = true;
+            slot.turn.store(position + 1, std::memory_order_release);
+        }
+    }
+
+    // Claim the next position of key's lane, refilling it from the tail when
+    // its block is used up
+    uint64_t claim(const K& key) {
+        if (block_size == 1) {
+            return tail.fetch_add(1, std::memory_order_relaxed);
+        }
+        Lane& lane = lane_of(key);
+        uint64_t next = lane.next.load(std::memory_order_relaxed);
+        while (next % block_size != 0) {
+            if (lane.next.compare_exchange_weak(next, next + 1, std::memory_order_relaxed)) {
+                return next;
+            }
+        }
+
+        uint64_t start = tail.fetch_add(block_size, std::memory_order_relaxed);
+        while (next <= start) {
+            // Install our block even over an older one with positions left, so
+            // the lane never hands out a position below one already returned
+            if (lane.next.compare_exchange_weak(next, start + 1, std::memory_order_relaxed)) {
+                if (next % block_size != 0) {
+                    pad(next, block_end(next));
+                }
+                return start;
+            }
+        }
+        // A newer block got there first; ours is not needed past start
+        pad(start + 1, start + block_size);
+        return start;
+    }
+
+    // Consumer side: the unpublished position is still an unused reservation
+    // in some lane (the lane's next is in its block and not past it). Take the
+    // reservation's rest and pad it. The block ends within a ring of position,
+    // whose slots consumers have already released, so this never waits on them
+    void release_reservation(uint64_t position) {
+        if (block_size == 1 || position >= tail.load(std::memory_order_relaxed)) {
+            return;
+        }
+        uint64_t block = position / block_size;
+        for (size_t i = 0; i < LANES; i++) {
+            uint64_t next = lanes[i].next.load(std::memory_order_relaxed);
+            while (next % block_size != 0 && next / block_size == block && next <= position) {
+                if (lanes[i].next.compare_exchange_weak(next, block_end(next),
+                                                        std::memory_order_relaxed)) {
+                    pad(next, block_end(next));
+                    return;
+                }
+            }
+        }
+    }
+
+public:
+    // Capacity is rounded up to a power of two; block_size is capped at half
+    // of it
+    explicit MutationFeed(size_t min_capacity = 1 << 16, size_t positions_per_block = 16) {
+        if (min_capacity == 0) {
+            throw std::invalid_argument("MutationFeed capacity must be positive");
+        }
+        capacity = 1;
+        while (capacity < min_capacity) {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        block_size = std::max<uint64_t>(1, std::min<uint64_t>(positions_per_block, capacity / 2));
+        slots.reset(new Slot[capacity]);
+        for (size_t i = 0; i < capacity; i++) {
+            slots[i].turn.store(i, std::memory_order_relaxed);
+        }
+        lanes.reset(new Lane[LANES]);
+    }
+
+    MutationFeed(const MutationFeed&) = delete;
+    MutationFeed& operator=(const MutationFeed&) = delete;
+
+    // Returns the record's sequence
+    uint64_t publish(Type type, const K& key, const V* value) {
+        uint64_t position = claim(key);
+        write(position, type, key, value);
+        return position;
+    }
+
+    // Publish one record per (key, value) pair in [first, last); values are
+    // ignored for REMOVE. Each record goes through its key's lane like
+    // publish(), so a batch touches the shared tail about once per
+    // block_size records. Returns the first record's sequence
+    template<typename Iterator>
+    uint64_t publish_batch(Type type, Iterator first, Iterator last) {
+        uint64_t start = 0;
+        for (bool at_first = true; first != last; ++first, at_first = false) {
+            uint64_t position = publish(type, first->first, &first->second);
+            start = at_first ? position : start;
+        }
+        return start;
+    }
+
+    // Take the next record in sequence order, if it has been published
+    bool try_pop(Mutation& out) {
+        uint64_t position = head.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slot_at(position);
+            uint64_t turn = slot.turn.load(std::memory_order_acquire);
+            if (turn != position + 1) {
+                if (turn < position + 1) {
+                    // Not yet published: a producer is writing it, or it sits
+                    // in an idle lane's reservation that we can pad
+                    release_reservation(position);
+                    if (slot.turn.load(std::memory_order_acquire) != position + 1) {
+                        return false;
+                    }
+                    continue;
+                }
+                position = head.load(std::memory_order_relaxed); // Another consumer took it
+                continue;
+            }
+            if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                bool padding = slot.padding;
+                if (!padding) {
+                    out = std::move(slot.mutation);
+                }
+                slot.turn.store(position + capacity, std::memory_order_release);
+                if (padding) {
+                    position++;
+                    continue;
+                }
+                return true;
+            }
+        }
+    }
+
+    // Pop up to max_records records, calling fn(const Mutation&) for each
+    template<typename F>
+    size_t drain(F&& fn, size_t max_records = SIZE_MAX) {
+        Mutation mutation;
+        size_t drained = 0;
+        while (drained < max_records && try_pop(mutation)) {
+            fn(mutation);
+            drained++;
+        }
+        return drained;
+    }
+
+    // Upper bound on the sequence the next published record will get
+    uint64_t next_sequence() const {
+        return tail.load(std::memory_order_relaxed);
+    }
+
+    // Positions claimed but not yet consumed, including reserved and padding
+    // positions (approximate while producers run)
+    uint64_t backlog() const {
+        uint64_t consumed = head.load(std::memory_order_relaxed);
+        uint64_t claimed = tail.load(std::memory_order_relaxed);
+        return claimed > consumed ? claimed - consumed : 0;
+    }
+
+    size_t ring_capacity() const {
+        return capacity;
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Compile-time optional operation counters
+// Define LOCKFREE_HASHMAP_ENABLE_COUNTERS to turn them on. When it is not defined
+// every LFHM_COUNT / LFHM_IF_COUNTERS expands to nothing, so instrumented hot
+// paths compile to exactly the same code as before
+#ifdef LOCKFREE_HASHMAP_ENABLE_COUNTERS
+#define LFHM_IF_COUNTERS(...) __VA_ARGS__
+#define LFHM_COUNT(counters, counter, n) (counters).add((counter), (n))
+#else
+#define LFHM_IF_COUNTERS(...)
+#define LFHM_COUNT(counters, counter, n) ((void)0)
+#endif
+
+// Threads that can own a counter slot at once; see per_thread_counter_slot()
+constexpr size_t PER_THREAD_COUNTER_SLOTS = 128;
+
+// Lease on a slot index, taken on a thread's first use and returned when it
+// exits, so threads may come and go without running out of slots. While all
+// PER_THREAD_COUNTER_SLOTS indices are leased, further threads get the index
+// PER_THREAD_COUNTER_SLOTS itself, which they all share
+class PerThreadCounterSlot {
+private:
+    struct Pool {
+        std::mutex lock;
+        std::vector<size_t> released;
+        size_t next = 0;
+    };
+
+    static Pool& pool() {
+        static Pool* slots = new Pool(); // Outlives thread_local leases
+        return *slots;
+    }
+
+    size_t slot;
+
+public:
+    PerThreadCounterSlot() {
+        Pool& slots = pool();
+        std::lock_guard<std::mutex> guard(slots.lock);
+        if (!slots.released.empty()) {
+            slot = slots.released.back();
+            slots.released.pop_back();
+        } else if (slots.next < PER_THREAD_COUNTER_SLOTS) {
+            slot = slots.next++;
+        } else {
+            slot = PER_THREAD_COUNTER_SLOTS;
+        }
+    }
+
+    ~PerThreadCounterSlot() {
+        if (slot != PER_THREAD_COUNTER_SLOTS) {
+            Pool& slots = pool();
+            std::lock_guard<std::mutex> guard(slots.lock);
+            slots.released.push_back(slot);
+        }
+    }
+
+    PerThreadCounterSlot(const PerThreadCounterSlot&) = delete;
+    PerThreadCounterSlot& operator=(const PerThreadCounterSlot&) = delete;
+
+    size_t get() const {
+        return slot;
+    }
+};
+
+// Slot used by the calling thread in every PerThreadCounters instance
+// Shared across all counter sets so a thread touches the same slot index everywhere
+// Below PER_THREAD_COUNTER_SLOTS the calling thread is the slot's only user
+inline size_t per_thread_counter_slot() {
+    thread_local PerThreadCounterSlot lease;
+    return lease.get();
+}
+
+// One cache line (or more) of counters per thread, summed on demand
+// A leased slot has a single writer, so its increments are a relaxed load +
+// store rather than a locked RMW; the shared overflow slot uses fetch_add, so
+// no count is lost however many threads run
+template<size_t N>
+class PerThreadCounters {
+private:
+    static constexpr size_t SLOTS = PER_THREAD_COUNTER_SLOTS + 1; // Leased + overflow
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> values[N];
+
+        Slot() {
+            for (auto& value : values) {
+                value.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::unique_ptr<Slot[]> slots;
+
+public:
+    PerThreadCounters() : slots(new Slot[SLOTS]) {}
+
+    PerThreadCounters(const PerThreadCounters&) = delete;
+    PerThreadCounters& operator=(const PerThreadCounters&) = delete;
+
+    template<typename E>
+    void add(E counter, uint64_t n) {
+        size_t index = per_thread_counter_slot();
+        std::atomic<uint64_t>& value = slots[index].values[static_cast<size_t>(counter)];
+        if (index < PER_THREAD_COUNTER_SLOTS) {
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        } else {
+            value.fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    // Aggregate over all threads (weakly consistent while writers are running)
+    std::array<uint64_t, N> sum() const {
+        std::array<uint64_t, N> totals{};
+        for (size_t t = 0; t < SLOTS; t++) {
+            for (size_t i = 0; i < N; i++) {
+                totals[i] += slots[t].values[i].load(std::memory_order_relaxed);
+            }
+        }
+        return totals;
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "work_stealing_pool.hpp"
+
+// Number of workers bulk operations use when the caller passes 0
+inline size_t default_parallelism() {
+    size_t hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : hardware;
+}
+
+// Pool bulk operations run on when the calling thread has no other: one
+// worker per hardware thread but one (the caller of run() works too). Never
+// destroyed, so bulk operations stay usable from static destructors
+inline WorkStealingPool& default_pool() {
+    static WorkStealingPool* pool = new WorkStealingPool();
+    return *pool;
+}
+
+// Run fn(worker_index) for every worker_index in [0, workers) as tasks on a
+// work-stealing pool and wait for all of them; the calling thread runs tasks
+// too. The pool is `pool` if given, else WorkStealingPool::current(), else
+// default_pool(). Tasks may share threads, so they must not wait on each
+// other. The first exception thrown by any task is rethrown after every task
+// has finished
+template<typename F>
+void run_parallel(size_t workers, F&& fn, WorkStealingPool* pool = nullptr) {
+    if (workers == 0) {
+        workers = default_parallelism();
+    }
+    if (pool == nullptr) {
+        pool = WorkStealingPool::current();
+    }
+    (pool != nullptr ? *pool : default_pool()).run(workers, fn);
+}
+
+// Run fn(worker_index) on `workers` dedicated threads (the caller's thread
+// runs worker 0) and wait for all of them, for long-running loops that must
+// all make progress at once. The first exception thrown by any worker is
+// rethrown after every worker has finished
+template<typename F>
+void run_threads(size_t workers, F&& fn) {
+    if (workers == 0) {
+        workers = default_parallelism();
+    }
+
+    std::vector<std::exception_ptr> errors(workers);
+    auto guarded = [&fn, &errors](size_t worker) {
+        try {
+            fn(worker);
+        } catch (...) {
+            errors[worker] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; worker++) {
+        threads.emplace_back(guarded, worker);
+    }
+    guarded(0);
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
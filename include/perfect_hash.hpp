@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+
+// Read-only map over a static key set indexed by a minimal perfect hash
+//
+// BBHash-style construction: at level l every remaining key hashes to a bit in
+// an array of gamma * remaining bits; keys that land alone keep their bit,
+// colliding keys move on to the next level. The final index of a key is the
+// rank of its bit across all levels, so keys and values sit in dense arrays
+// and a lookup is one std::hash call, a few remix/rank steps (almost always on
+// level 0) and one key comparison. With gamma = 1 the index costs about 3 bits
+// per key. The few keys still colliding after MAX_LEVELS go to a small
+// fallback table
+template<typename K, typename V, typename Hash = std::hash<K>>
+class PerfectHashMap {
+private:
+    static constexpr size_t MAX_LEVELS = 32;
+    static constexpr size_t WORDS_PER_RANK_BLOCK = 8;
+    static constexpr uint64_t NOT_FOUND = UINT64_MAX;
+
+    struct Level {
+        uint64_t bit_offset; // Position of this level's first bit in `bits`
+        uint64_t size;       // Bits in this level (multiple of 64)
+    };
+
+    std::vector<Level> levels;
+    std::vector<uint64_t> bits;
+    std::vector<uint64_t> rank_blocks; // Set bits before each 512-bit block
+    std::unordered_map<K, uint64_t, Hash> fallback;
+    std::vector<K> keys;
+    std::vector<V> values;
+    Hash hasher;
+
+    static uint64_t mix(uint64_t hash, size_t level) {
+        uint64_t x = hash + (level + 1) * 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    static uint64_t reduce(uint64_t hash, uint64_t range) {
+#if defined(__SIZEOF_INT128__)
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(hash) * range) >> 64);
+#else
+        return hash % range;
+#endif
+    }
+
+    static uint64_t popcount(uint64_t word) {
+        return std::bitset<64>(word).count();
+    }
+
+    bool test(uint64_t position) const {
+        return (bits[position / 64] >> (position % 64)) & 1;
+    }
+
+    uint64_t rank(uint64_t position) const {
+        size_t word = position / 64;
+        size_t block = word / WORDS_PER_RANK_BLOCK;
+        uint64_t count = rank_blocks[block];
+        for (size_t w = block * WORDS_PER_RANK_BLOCK; w < word; w++) {
+            count += popcount(bits[w]);
+        }
+        return count + popcount(bits[word] & ((uint64_t(1) << (position % 64)) - 1));
+    }
+
+    // Dense index of a key, or NOT_FOUND when it cannot be in the set
+    uint64_t index_of(const K& key) const {
+        uint64_t hash = hasher(key);
+        for (size_t level = 0; level < levels.size(); level++) {
+            uint64_t position = levels[level].bit_offset + reduce(mix(hash, level), levels[level].size);
+            if (test(position)) {
+                return rank(position);
+            }
+        }
+        auto it = fallback.find(key);
+        return it == fallback.end() ? NOT_FOUND : it->second;
+    }
+
+public:
+    // Build over entries with distinct keys (later duplicates are dropped)
+    // Each level is hashed by `threads` workers (0 = one per core); gamma >= 1
+    // trades memory for fewer levels and a faster build
+    static PerfectHashMap build(std::vector<std::pair<K, V>> entries,
+                                size_t threads = 0, double gamma = 1.0) {
+        if (threads == 0) {
+            threads = default_parallelism();
+        }
+        if (gamma < 1.0) {
+            gamma = 1.0;
+        }
+
+        PerfectHashMap map;
+        size_t n = entries.size();
+        std::vector<uint64_t> hashes(n);
+        run_parallel(threads, [&](size_t worker) {
+            for (size_t i = n * worker / threads; i < n * (worker + 1) / threads; i++) {
+                hashes[i] = map.hasher(entries[i].first);
+            }
+        });
+
+        std::vector<size_t> remaining(n);
+        for (size_t i = 0; i < n; i++) {
+            remaining[i] = i;
+        }
+
+        for (size_t level = 0; level < MAX_LEVELS && !remaining.empty(); level++) {
+            uint64_t size = static_cast<uint64_t>(gamma * static_cast<double>(remaining.size()));
+            size = ((std::max<uint64_t>(size, 64) + 63) / 64) * 64;
+            size_t words = static_cast<size_t>(size / 64);
+
+            std::vector<std::atomic<uint64_t>> seen(words);
+            std::vector<std::atomic<uint64_t>> collided(words);
+            size_t count = remaining.size();
+
+            run_parallel(threads, [&](size_t worker) {
+                for (size_t i = count * worker / threads; i < count * (worker + 1) / threads; i++) {
+                    uint64_t position = reduce(mix(hashes[remaining[i]], level), size);
+                    uint64_t bit = uint64_t(1) << (position % 64);
+                    if (seen[position / 64].fetch_or(bit, std::memory_order_relaxed) & bit) {
+                        collided[position / 64].fetch_or(bit, std::memory_order_relaxed);
+                    }
+                }
+            });
+
+            std::vector<std::vector<size_t>> next(threads);
+            run_parallel(threads, [&](size_t worker) {
+                for (size_t i = count * worker / threads; i < count * (worker + 1) / threads; i++) {
+                    uint64_t position = reduce(mix(hashes[remaining[i]], level), size);
+                    uint64_t bit = uint64_t(1) << (position % 64);
+                    if (collided[position / 64].load(std::memory_order_relaxed) & bit) {
+                        next[worker].push_back(remaining[i]);
+                    }
+                }
+            });
+
+            map.levels.push_back({map.bits.size() * 64, size});
+            for (size_t w = 0; w < words; w++) {
+                map.bits.push_back(seen[w].load(std::memory_order_relaxed) &
+                                   ~collided[w].load(std::memory_order_relaxed));
+            }
+
+            remaining.clear();
+            for (auto& worker_next : next) {
+                remaining.insert(remaining.end(), worker_next.begin(), worker_next.end());
+            }
+        }
+
+        map.bits.resize(((map.bits.size() + WORDS_PER_RANK_BLOCK - 1) / WORDS_PER_RANK_BLOCK) *
+                        WORDS_PER_RANK_BLOCK + WORDS_PER_RANK_BLOCK, 0);
+        uint64_t total = 0;
+        for (size_t w = 0; w < map.bits.size(); w++) {
+            if (w % WORDS_PER_RANK_BLOCK == 0) {
+                map.rank_blocks.push_back(total);
+            }
+            total += popcount(map.bits[w]);
+        }
+
+        std::vector<size_t> fallback_entries;
+        for (size_t i : remaining) {
+            if (map.fallback.emplace(entries[i].first, total + fallback_entries.size()).second) {
+                fallback_entries.push_back(i);
+            }
+        }
+
+        size_t slots = static_cast<size_t>(total) + fallback_entries.size();
+        map.keys.resize(slots);
+        map.values.resize(slots);
+        run_parallel(threads, [&](size_t worker) {
+            for (size_t i = n * worker / threads; i < n * (worker + 1) / threads; i++) {
+                uint64_t index = map.index_of(entries[i].first);
+                if (index < total) {
+                    map.keys[index] = entries[i].first;
+                    map.values[index] = entries[i].second;
+                }
+            }
+        });
+        for (size_t slot = 0; slot < fallback_entries.size(); slot++) {
+            map.keys[total + slot] = entries[fallback_entries[slot]].first;
+            map.values[total + slot] = entries[fallback_entries[slot]].second;
+        }
+        return map;
+    }
+
+    bool get(const K& key, V& value) const {
+        uint64_t index = index_of(key);
+        if (index == NOT_FOUND || !(keys[index] == key)) {
+            return false;
+        }
+        value = values[index];
+        return true;
+    }
+
+    bool contains(const K& key) const {
+        uint64_t index = index_of(key);
+        return index != NOT_FOUND && keys[index] == key;
+    }
+
+    size_t size() const {
+        return keys.size();
+    }
+
+    // Bits spent on the hash index itself (level bits, rank table, fallback
+    // entries), excluding the dense key and value arrays
+    double bits_per_key() const {
+        if (keys.empty()) {
+            return 0.0;
+        }
+        double index_bits = 64.0 * static_cast<double>(bits.size() + rank_blocks.size()) +
+            8.0 * static_cast<double>(fallback.size() * (sizeof(K) + sizeof(uint64_t)));
+        return index_bits / static_cast<double>(keys.size());
+    }
+
+    size_t level_count() const {
+        return levels.size();
+    }
+};
@@ -0,0 +1,540 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <signal.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "op_counters.hpp"
+#include "snapshot.hpp"
+
+// Variant of LockFreeHashMap that lives entirely inside one shared memory
+// region (POSIX shm_open or an anonymous memfd), so every process on a host
+// can map the same copy and use it lock-free.
+//
+// Nothing in the region holds a raw pointer: links are byte offsets from the
+// region start (0 = null), so each process may map it at a different address.
+// Nodes come from an in-region allocator (bump pointer plus a free list) and
+// removed nodes are physically unlinked (Harris-Michael marked links) and
+// recycled once no reader in any process can still see them. Reclamation uses
+// epochs: readers register in per-process lanes of two counters (one per epoch
+// parity), and a node retired in epoch e is reused once the global epoch
+// reaches e + 2. Lanes of a process that died mid-operation are reset when a
+// reclaimer finds them blocking the epoch.
+//
+// Keys and values are copied bytewise, so K must be padding-free and V
+// trivially copyable; keys are hashed by their bytes with a fixed seed so all
+// processes agree on bucket placement. Like LockFreeHashMap, insert() allows
+// duplicates and get() returns the newest
+template<typename K, typename V>
+class SharedHashMap {
+    static_assert(std::has_unique_object_representations<K>::value,
+                  "shared keys are hashed and compared bytewise, so K must have no padding");
+    static_assert(std::is_trivially_copyable<V>::value,
+                  "shared values are stored as raw bytes, so V must be trivially copyable");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<int32_t>::is_always_lock_free,
+                  "shared memory atomics must be lock-free to work across processes");
+
+private:
+    static constexpr char MAGIC[8] = {'L', 'F', 'H', 'M', 'S', 'H', 'R', 'D'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t HASH_SEED = 0x7368617265646D61ULL;
+    static constexpr size_t MAX_PROCESSES = 64;
+    static constexpr size_t LANES = 8;             // Reader lanes per process
+    static constexpr uint64_t MARK = 1;            // Logical deletion bit in Node::next
+    static constexpr uint64_t OFFSET_BITS = 40;    // Tagged stack heads: tag | offset
+    static constexpr uint64_t OFFSET_MASK = (uint64_t(1) << OFFSET_BITS) - 1;
+    static constexpr uint64_t RETIRES_PER_ADVANCE = 64;
+    static constexpr int MAX_ALLOCATION_ATTEMPTS = 10000;
+
+    struct Node {
+        std::atomic<uint64_t> next; // Chain link | MARK
+        std::atomic<uint64_t> link; // Limbo/free list link
+        K key;
+        V value;
+    };
+
+    struct alignas(64) Lane {
+        std::atomic<uint64_t> readers[2]; // Indexed by epoch parity
+    };
+
+    struct alignas(64) Process {
+        std::atomic<int32_t> pid; // 0 = free slot
+        Lane lanes[LANES];
+    };
+
+    struct alignas(64) Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order_mark;
+        uint32_t key_size;
+        uint32_t value_size;
+        uint64_t bucket_count;
+        uint64_t region_size;
+        uint64_t buckets_offset;
+        uint64_t nodes_offset;
+        std::atomic<uint32_t> ready; // Set last by create
+
+        alignas(64) std::atomic<uint64_t> bump;      // First never-allocated byte
+        alignas(64) std::atomic<uint64_t> free_head; // Tagged
+        alignas(64) std::atomic<uint64_t> epoch;
+        std::atomic<uint64_t> limbo[3];              // Tagged, by retire epoch % 3
+        Process processes[MAX_PROCESSES];
+    };
+
+    unsigned char* base = nullptr;
+    size_t region_size = 0;
+    int fd = -1;
+    Header* header = nullptr;
+    std::atomic<uint64_t>* buckets = nullptr;
+    Process* process = nullptr;
+    std::atomic<uint64_t> local_retires{0};
+
+    Node* node(uint64_t offset) const {
+        return reinterpret_cast<Node*>(base + offset);
+    }
+
+    static uint64_t hash_key(const K& key) {
+        return snapshot_checksum(&key, sizeof(K), HASH_SEED);
+    }
+
+    static uint64_t tagged(uint64_t old_head, uint64_t offset) {
+        return (((old_head >> OFFSET_BITS) + 1) << OFFSET_BITS) | offset;
+    }
+
+    // Treiber stack of nodes through Node::link; the tag defeats ABA
+    void push(std::atomic<uint64_t>& head, uint64_t first, uint64_t last) {
+        uint64_t old_head = head.load(std::memory_order_acquire);
+        do {
+            node(last)->link.store(old_head & OFFSET_MASK, std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(old_head, tagged(old_head, first),
+                                             std::memory_order_release,
+                                             std::memory_order_acquire));
+    }
+
+    uint64_t pop(std::atomic<uint64_t>& head) {
+        uint64_t old_head = head.load(std::memory_order_acquire);
+        while (true) {
+            uint64_t offset = old_head & OFFSET_MASK;
+            if (offset == 0) {
+                return 0;
+            }
+            // May read a node another process just popped; the tag then fails the CAS
+            uint64_t next = node(offset)->link.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, tagged(old_head, next),
+                                           std::memory_order_acquire,
+                                           std::memory_order_acquire)) {
+                return offset;
+            }
+        }
+    }
+
+    // Epoch guard: registers the calling thread as a reader for one operation
+    class ReadGuard {
+        std::atomic<uint64_t>* counter;
+
+    public:
+        explicit ReadGuard(const SharedHashMap& map) {
+            Lane& lane = map.process->lanes[per_thread_counter_slot() % LANES];
+            while (true) {
+                uint64_t epoch = map.header->epoch.load();
+                counter = &lane.readers[epoch & 1];
+                counter->fetch_add(1);
+                if (map.header->epoch.load() == epoch) {
+                    break;
+                }
+                counter->fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        ~ReadGuard() {
+            counter->fetch_sub(1, std::memory_order_release);
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    static bool process_alive(int32_t pid) {
+        return pid == static_cast<int32_t>(::getpid()) || ::kill(pid, 0) == 0 || errno != ESRCH;
+    }
+
+    void reset_process(Process& slot, int32_t pid) {
+        for (auto& lane : slot.lanes) {
+            lane.readers[0].store(0);
+            lane.readers[1].store(0);
+        }
+        slot.pid.compare_exchange_strong(pid, 0);
+    }
+
+    // Advance the global epoch if no reader is left in the previous one, then
+    // recycle the nodes retired two epochs before the new one
+    bool try_advance() {
+        uint64_t epoch = header->epoch.load();
+        size_t parity = (epoch - 1) & 1;
+        for (auto& slot : header->processes) {
+            int32_t pid = slot.pid.load();
+            if (pid == 0) {
+                continue;
+            }
+            for (auto& lane : slot.lanes) {
+                if (lane.readers[parity].load() != 0) {
+                    if (process_alive(pid)) {
+                        return false;
+                    }
+                    reset_process(slot, pid);
+                    break;
+                }
+            }
+        }
+        if (!header->epoch.compare_exchange_strong(epoch, epoch + 1)) {
+            return false;
+        }
+
+        std::atomic<uint64_t>& limbo = header->limbo[(epoch + 2) % 3];
+        uint64_t old_head = limbo.load(std::memory_order_acquire);
+        while (!limbo.compare_exchange_weak(old_head, tagged(old_head, 0),
+                                            std::memory_order_acquire,
+                                            std::memory_order_acquire)) {
+        }
+        uint64_t first = old_head & OFFSET_MASK;
+        if (first != 0) {
+            uint64_t last = first;
+            for (uint64_t next; (next = node(last)->link.load(std::memory_order_relaxed)) != 0;) {
+                last = next;
+            }
+            push(header->free_head, first, last);
+        }
+        return true;
+    }
+
+    void retire(uint64_t offset) {
+        uint64_t epoch = header->epoch.load();
+        push(header->limbo[epoch % 3], offset, offset);
+        if (local_retires.fetch_add(1, std::memory_order_relaxed) % RETIRES_PER_ADVANCE == 0) {
+            try_advance();
+        }
+    }
+
+    uint64_t allocate() {
+        uint64_t offset = pop(header->free_head);
+        if (offset != 0) {
+            return offset;
+        }
+        offset = header->bump.fetch_add(sizeof(Node), std::memory_order_relaxed);
+        if (offset + sizeof(Node) <= header->region_size) {
+            return offset;
+        }
+        // Region exhausted: wait for retired nodes to become reusable, which
+        // takes two epoch advances and can be held up by a descheduled reader
+        for (int attempt = 0; attempt < MAX_ALLOCATION_ATTEMPTS; attempt++) {
+            try_advance();
+            offset = pop(header->free_head);
+            if (offset != 0) {
+                return offset;
+            }
+            std::this_thread::yield();
+        }
+        throw std::runtime_error("shared hash map region is full");
+    }
+
+    static size_t align_up(size_t n) {
+        return (n + 63) & ~size_t(63);
+    }
+
+    [[noreturn]] static void fail(const std::string& what) {
+        throw std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    void map_region(int descriptor, size_t size) {
+        void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(descriptor);
+            fail("cannot mmap shared hash map");
+        }
+        fd = descriptor;
+        base = static_cast<unsigned char*>(mapping);
+        region_size = size;
+        header = reinterpret_cast<Header*>(base);
+    }
+
+    void attach_process() {
+        buckets = reinterpret_cast<std::atomic<uint64_t>*>(base + header->buckets_offset);
+        int32_t me = static_cast<int32_t>(::getpid());
+        for (int pass = 0; pass < 2; pass++) {
+            for (auto& slot : header->processes) {
+                int32_t pid = slot.pid.load();
+                if (pass == 1 && pid != 0 && !process_alive(pid)) {
+                    reset_process(slot, pid);
+                    pid = slot.pid.load();
+                }
+                if (pid == 0 && slot.pid.compare_exchange_strong(pid, me)) {
+                    process = &slot;
+                    return;
+                }
+            }
+        }
+        throw std::runtime_error("too many processes attached to the shared hash map");
+    }
+
+    static SharedHashMap initialise(int descriptor, size_t bucket_count, size_t region_bytes) {
+        if (bucket_count == 0) {
+            ::close(descriptor);
+            throw std::invalid_argument("SharedHashMap bucket count must be positive");
+        }
+        size_t buckets_offset = align_up(sizeof(Header));
+        size_t nodes_offset = align_up(buckets_offset + bucket_count * sizeof(uint64_t));
+        if (region_bytes < nodes_offset + sizeof(Node) || region_bytes > OFFSET_MASK) {
+            ::close(descriptor);
+            throw std::invalid_argument("SharedHashMap region size does not fit the buckets");
+        }
+        if (::ftruncate(descriptor, static_cast<off_t>(region_bytes)) != 0) {
+            ::close(descriptor);
+            fail("cannot size shared hash map");
+        }
+
+        SharedHashMap map;
+        map.map_region(descriptor, region_bytes);
+        Header* h = new (map.base) Header();
+        h->version = VERSION;
+        h->byte_order_mark = SnapshotHeader::BYTE_ORDER_MARK;
+        h->key_size = sizeof(K);
+        h->value_size = sizeof(V);
+        h->bucket_count = bucket_count;
+        h->region_size = region_bytes;
+        h->buckets_offset = buckets_offset;
+        h->nodes_offset = nodes_offset;
+        h->bump.store(nodes_offset, std::memory_order_relaxed);
+        h->epoch.store(2, std::memory_order_relaxed); // epoch - 1 never underflows
+        for (size_t i = 0; i < bucket_count; i++) {
+            new (map.base + buckets_offset + i * sizeof(uint64_t)) std::atomic<uint64_t>(0);
+        }
+        std::memcpy(h->magic, MAGIC, sizeof(MAGIC));
+        h->ready.store(1, std::memory_order_release);
+        map.attach_process();
+        return map;
+    }
+
+    static SharedHashMap open_existing(int descriptor) {
+        struct stat st;
+        if (::fstat(descriptor, &st) != 0) {
+            ::close(descriptor);
+            fail("cannot stat shared hash map");
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        if (size < sizeof(Header)) {
+            ::close(descriptor);
+            throw std::runtime_error("shared hash map region is truncated");
+        }
+
+        SharedHashMap map;
+        map.map_region(descriptor, size);
+        const Header* h = map.header;
+        if (h->ready.load(std::memory_order_acquire) != 1 ||
+            std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->version != VERSION ||
+            h->byte_order_mark != SnapshotHeader::BYTE_ORDER_MARK) {
+            throw std::runtime_error("region is not an initialised shared hash map");
+        }
+        if (h->key_size != sizeof(K) || h->value_size != sizeof(V)) {
+            throw std::runtime_error("shared hash map was created with different key/value types");
+        }
+        if (h->region_size != size || h->buckets_offset != align_up(sizeof(Header)) ||
+            h->nodes_offset != align_up(h->buckets_offset + h->bucket_count * sizeof(uint64_t)) ||
+            h->nodes_offset > size) {
+            throw std::runtime_error("shared hash map has an inconsistent layout");
+        }
+        map.attach_process();
+        return map;
+    }
+
+    void release() {
+        if (base == nullptr) {
+            return;
+        }
+        if (process != nullptr) {
+            process->pid.store(0);
+        }
+        ::munmap(base, region_size);
+        ::close(fd);
+        base = nullptr;
+    }
+
+    SharedHashMap() = default;
+
+public:
+    // Create a named region (fails if the name exists); other processes attach()
+    static SharedHashMap create(const std::string& name, size_t bucket_count, size_t region_bytes) {
+        int descriptor = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+        if (descriptor < 0) {
+            fail("cannot create shared memory " + name);
+        }
+        return initialise(descriptor, bucket_count, region_bytes);
+    }
+
+    static SharedHashMap attach(const std::string& name) {
+        int descriptor = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (descriptor < 0) {
+            fail("cannot open shared memory " + name);
+        }
+        return open_existing(descriptor);
+    }
+
+    static void unlink(const std::string& name) {
+        ::shm_unlink(name.c_str());
+    }
+
+    // Unnamed region; hand fd() to other processes (fork or SCM_RIGHTS) and
+    // attach them with attach_fd()
+    static SharedHashMap create_anonymous(size_t bucket_count, size_t region_bytes) {
+        int descriptor = ::memfd_create("lockfree_hashmap", MFD_CLOEXEC);
+        if (descriptor < 0) {
+            fail("cannot create memfd");
+        }
+        return initialise(descriptor, bucket_count, region_bytes);
+    }
+
+    // Attach through a descriptor of the region (duplicated; the caller keeps
+    // its own). A forked child must attach its own handle this way rather than
+    // use the parent's, so each process has its own reader lanes
+    static SharedHashMap attach_fd(int descriptor) {
+        int copy = ::fcntl(descriptor, F_DUPFD_CLOEXEC, 0);
+        if (copy < 0) {
+            fail("cannot duplicate shared hash map descriptor");
+        }
+        return open_existing(copy);
+    }
+
+    ~SharedHashMap() {
+        release();
+    }
+
+    SharedHashMap(SharedHashMap&& other) noexcept
+        : base(other.base), region_size(other.region_size), fd(other.fd), header(other.header),
+          buckets(other.buckets), process(other.process) {
+        other.base = nullptr;
+    }
+
+    SharedHashMap& operator=(SharedHashMap&& other) noexcept {
+        if (this != &other) {
+            release();
+            base = other.base;
+            region_size = other.region_size;
+            fd = other.fd;
+            header = other.header;
+            buckets = other.buckets;
+            process = other.process;
+            other.base = nullptr;
+        }
+        return *this;
+    }
+
+    SharedHashMap(const SharedHashMap&) = delete;
+    SharedHashMap& operator=(const SharedHashMap&) = delete;
+
+    // Throws std::runtime_error when the region has no free node left
+    // Needs no epoch guard: it only touches its own node and the bucket head
+    bool insert(const K& key, const V& value) {
+        uint64_t offset = allocate();
+        Node* n = node(offset);
+        std::memcpy(&n->key, &key, sizeof(K));
+        std::memcpy(&n->value, &value, sizeof(V));
+
+        std::atomic<uint64_t>& head = buckets[hash_key(key) % header->bucket_count];
+        uint64_t first = head.load(std::memory_order_acquire);
+        do {
+            n->next.store(first, std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(first, offset,
+                                             std::memory_order_release,
+                                             std::memory_order_acquire));
+        return true;
+    }
+
+    bool get(const K& key, V& value) const {
+        ReadGuard guard(*this);
+        uint64_t current = buckets[hash_key(key) % header->bucket_count].load(std::memory_order_acquire);
+        while (current != 0) {
+            const Node* n = node(current);
+            uint64_t next = n->next.load(std::memory_order_acquire);
+            if (!(next & MARK) && std::memcmp(&n->key, &key, sizeof(K)) == 0) {
+                std::memcpy(&value, &n->value, sizeof(V));
+                return true;
+            }
+            current = next & ~MARK;
+        }
+        return false;
+    }
+
+    bool contains(const K& key) const {
+        V value;
+        return get(key, value);
+    }
+
+    // Marks the newest copy deleted, unlinks it and recycles its node once no
+    // process can still be reading it; also unlinks marked nodes it passes
+    bool remove(const K& key) {
+        ReadGuard guard(*this);
+        std::atomic<uint64_t>& head = buckets[hash_key(key) % header->bucket_count];
+
+    retry:
+        std::atomic<uint64_t>* prev = &head;
+        uint64_t current = prev->load(std::memory_order_acquire);
+        while (current != 0) {
+            Node* n = node(current);
+            uint64_t next = n->next.load(std::memory_order_acquire);
+            if (next & MARK) {
+                // Help unlink a node another remover marked
+                if (!prev->compare_exchange_strong(current, next & ~MARK,
+                                                   std::memory_order_acq_rel)) {
+                    goto retry;
+                }
+                retire(current);
+                current = next & ~MARK;
+                continue;
+            }
+            if (std::memcmp(&n->key, &key, sizeof(K)) == 0) {
+                if (!n->next.compare_exchange_strong(next, next | MARK, std::memory_order_acq_rel)) {
+                    goto retry;
+                }
+                if (prev->compare_exchange_strong(current, next, std::memory_order_acq_rel)) {
+                    retire(current);
+                }
+                return true;
+            }
+            prev = &n->next;
+            current = next;
+        }
+        return false;
+    }
+
+    size_t bucket_count() const {
+        return static_cast<size_t>(header->bucket_count);
+    }
+
+    size_t region_bytes() const {
+        return region_size;
+    }
+
+    // Bytes handed out by the bump allocator so far (recycled nodes are reused first)
+    size_t used_bytes() const {
+        return static_cast<size_t>(std::min<uint64_t>(header->bump.load(std::memory_order_relaxed),
+                                                      header->region_size));
+    }
+
+    int descriptor() const {
+        return fd;
+    }
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Binary snapshot format used by LockFreeHashMap::save/load
+//
+//   SnapshotHeader (64 bytes)
+//   data chunks    (records back to back, written in parallel)
+//   chunk table    (SnapshotChunk per chunk, then a u64 checksum of the table)
+//
+// Numbers are stored in native byte order; byte_order_mark rejects files from
+// a machine with the other endianness. Every chunk, the chunk table and the
+// header carry a checksum
+
+// How keys and values are encoded in a snapshot
+// Trivially copyable types are written as raw bytes and std::string as a
+// byte string with a 32-bit length prefix. Specialise this for other types:
+//   static constexpr bool available = true;
+//   static constexpr uint32_t fixed_size = ...;  // 0 for variable length
+//   static void write(std::string& out, const T& value);
+//   static bool read(const char*& in, const char* end, T& value);
+template<typename T, typename Enable = void>
+struct SnapshotSerializer {
+    static constexpr bool available = false;
+};
+
+template<typename T>
+struct SnapshotSerializer<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+    static constexpr bool available = true;
+    static constexpr uint32_t fixed_size = sizeof(T);
+
+    static void write(std::string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static bool read(const char*& in, const char* end, T& value) {
+        if (static_cast<size_t>(end - in) < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return true;
+    }
+};
+
+template<>
+struct SnapshotSerializer<std::string> {
+    static constexpr bool available = true;
+    static constexpr uint32_t fixed_size = 0;
+
+    // The length prefix is 32 bits; a longer string would wrap and leave a
+    // snapshot whose checksums pass but whose records do not parse
+    static void write(std::string& out, const std::string& value) {
+        if (value.size() > UINT32_MAX) {
+            throw std::length_error("snapshot strings are limited to 4 GiB - 1 bytes");
+        }
+        uint32_t length = static_cast<uint32_t>(value.size());
+        out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.append(value);
+    }
+
+    static bool read(const char*& in, const char* end, std::string& value) {
+        uint32_t length;
+        if (static_cast<size_t>(end - in) < sizeof(length)) {
+            return false;
+        }
+        std::memcpy(&length, in, sizeof(length));
+        in += sizeof(length);
+        if (static_cast<size_t>(end - in) < length) {
+            return false;
+        }
+        value.assign(in, length);
+        in += length;
+        return true;
+    }
+};
+
+// 64-bit checksum over 8-byte words (multiply/rotate mixing)
+// Not cryptographic; catches truncation and bit rot at memory bandwidth
+inline uint64_t snapshot_checksum(const void* data, size_t length, uint64_t seed = 0) {
+    const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    uint64_t hash = seed ^ (length * PRIME1);
+    size_t offset = 0;
+    for (; offset + 8 <= length; offset += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + offset, 8);
+        hash ^= word * PRIME2;
+        hash = (hash << 31) | (hash >> 33);
+        hash *= PRIME1;
+    }
+
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes + offset, length - offset);
+    hash ^= tail * PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME1;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+struct SnapshotHeader {
+    static constexpr char MAGIC[8] = {'L', 'F', 'H', 'M', 'S', 'N', 'A', 'P'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint32_t key_size;   // SnapshotSerializer<K>::fixed_size
+    uint32_t value_size; // SnapshotSerializer<V>::fixed_size
+    uint64_t bucket_count;
+    uint64_t record_count;
+    uint64_t chunk_count;
+    uint64_t chunk_table_offset;
+    uint64_t checksum;   // Over all preceding header bytes
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header layout changed");
+
+struct SnapshotChunk {
+    uint64_t offset;
+    uint64_t length;
+    uint64_t record_count;
+    uint64_t checksum;
+};
+
+// Thin RAII wrapper over a POSIX file descriptor with positional I/O
+// Errors are reported as std::runtime_error naming the path
+class SnapshotFile {
+private:
+    int fd;
+    std::string path;
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error(std::string(what) + " " + path + ": " + std::strerror(errno));
+    }
+
+public:
+    SnapshotFile(const std::string& file_path, int flags)
+        : fd(::open(file_path.c_str(), flags | O_CLOEXEC, 0644)), path(file_path) {
+        if (fd < 0) {
+            fail("cannot open");
+        }
+    }
+
+    ~SnapshotFile() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    void write_at(const void* data, size_t length, uint64_t offset) {
+        const char* bytes = static_cast<const char*>(data);
+        while (length != 0) {
+            ssize_t written = ::pwrite(fd, bytes, length, static_cast<off_t>(offset));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                fail("cannot write");
+            }
+            bytes += written;
+            length -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+    }
+
+    void read_at(void* data, size_t length, uint64_t offset) const {
+        char* bytes = static_cast<char*>(data);
+        while (length != 0) {
+            ssize_t got = ::pread(fd, bytes, length, static_cast<off_t>(offset));
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                fail("cannot read");
+            }
+            if (got == 0) {
+                throw std::runtime_error("snapshot " + path + " is truncated");
+            }
+            bytes += got;
+            length -= static_cast<size_t>(got);
+            offset += static_cast<uint64_t>(got);
+        }
+    }
+
+    int descriptor() const {
+        return fd;
+    }
+
+    uint64_t size() const {
+        off_t end = ::lseek(fd, 0, SEEK_END);
+        if (end < 0) {
+            fail("cannot seek");
+        }
+        return static_cast<uint64_t>(end);
+    }
+
+    void sync() {
+        if (::fsync(fd) != 0) {
+            fail("cannot sync");
+        }
+    }
+
+    void close() {
+        int closing = fd;
+        fd = -1;
+        if (::close(closing) != 0) {
+            fail("cannot close");
+        }
+    }
+};
+
+// fsync the directory containing path so that creating, renaming or unlinking
+// path survives a crash
+inline void sync_parent_directory(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "."
+                            : slash == 0               ? "/"
+                                                       : path.substr(0, slash);
+    SnapshotFile(directory, O_RDONLY | O_DIRECTORY).sync();
+}
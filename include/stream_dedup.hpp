@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "lockfree_hashmap.hpp"
+#include "op_counters.hpp"
+
+// Streaming deduplication over a sliding window of generations. Keys are
+// recorded in the current generation's map; seen_before() checks every live
+// generation. When the current generation fills up (keys_per_generation new
+// keys) or ages out (generation_duration), a new empty generation becomes
+// current and the oldest one is destroyed as a whole, freeing all its nodes at
+// once instead of tombstoning keys one by one. A key is remembered for at least
+// generations - 1 full generations, so memory is bounded by the window.
+//
+// For a key first seen inside the window exactly one caller gets false, except
+// that callers racing on the same key across a rotation may both get false;
+// a first occurrence is never reported as a duplicate.
+//
+// Readers bracket their map accesses with a per-thread-slot reader count for
+// the current epoch parity; a rotation flips the parity and waits for the old
+// parity's readers to drain before deleting the dropped generation
+template<typename K>
+class StreamDeduplicator {
+public:
+    struct Options {
+        size_t generations = 4;                    // Window length, at least 2
+        size_t keys_per_generation = 1 << 20;      // 0: no count-based rotation
+        std::chrono::milliseconds generation_duration{0}; // 0: no time-based rotation
+        size_t buckets_per_generation = 0;         // 0: keys_per_generation (or 65536)
+    };
+
+private:
+    static constexpr size_t READER_SLOTS = 64;
+
+    struct Generation {
+        LockFreeHashMap<K, uint8_t> keys;
+        std::atomic<size_t> inserted{0};
+
+        explicit Generation(size_t buckets) : keys(buckets) {}
+    };
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> readers[2] = {};
+    };
+
+    Options options;
+    size_t buckets;
+    std::unique_ptr<std::atomic<Generation*>[]> ring;
+    std::atomic<uint64_t> current{0};
+    std::atomic<int64_t> rotate_after_ns{0};
+
+    std::atomic<uint64_t> epoch{0};
+    std::unique_ptr<ReaderSlot[]> reader_slots;
+    std::mutex rotation_mutex;
+    std::atomic<uint64_t> rotation_count{0};
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int64_t next_deadline() const {
+        return options.generation_duration.count() > 0
+                   ? now_ns() + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    options.generation_duration).count()
+                   : INT64_MAX;
+    }
+
+    // Caller holds rotation_mutex
+    void rotate_locked() {
+        uint64_t next = current.load() + 1;
+        std::atomic<Generation*>& slot = ring[next % options.generations];
+        Generation* dropped = slot.load();
+        slot.store(new Generation(buckets));
+        current.store(next);
+        rotate_after_ns.store(next_deadline(), std::memory_order_relaxed);
+
+        // Readers that may still hold the dropped generation entered under the
+        // old parity; wait for them before freeing it
+        uint64_t old_parity = epoch.fetch_add(1) & 1;
+        for (size_t i = 0; i < READER_SLOTS; i++) {
+            while (reader_slots[i].readers[old_parity].load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+        delete dropped;
+        rotation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Rotate unless another thread already moved past generation number
+    void rotate_from(uint64_t number) {
+        std::unique_lock<std::mutex> guard(rotation_mutex, std::try_to_lock);
+        if (guard.owns_lock() && current.load() == number) {
+            rotate_locked();
+        }
+    }
+
+public:
+    explicit StreamDeduplicator(Options opts = Options()) : options(opts) {
+        if (options.generations < 2) {
+            throw std::invalid_argument("StreamDeduplicator needs at least 2 generations");
+        }
+        buckets = options.buckets_per_generation != 0 ? options.buckets_per_generation
+                  : options.keys_per_generation != 0  ? options.keys_per_generation
+                                                      : size_t{1} << 16;
+        ring.reset(new std::atomic<Generation*>[options.generations]);
+        for (size_t i = 0; i < options.generations; i++) {
+            ring[i].store(new Generation(buckets), std::memory_order_relaxed);
+        }
+        reader_slots.reset(new ReaderSlot[READER_SLOTS]);
+        rotate_after_ns.store(next_deadline(), std::memory_order_relaxed);
+    }
+
+    ~StreamDeduplicator() {
+        for (size_t i = 0; i < options.generations; i++) {
+            delete ring[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    StreamDeduplicator(const StreamDeduplicator&) = delete;
+    StreamDeduplicator& operator=(const StreamDeduplicator&) = delete;
+
+    // True if key was already recorded inside the window; otherwise records it
+    // in the current generation and returns false
+    bool seen_before(const K& key) {
+        // Re-check the epoch after registering: a rotation that flipped it in
+        // between would otherwise only wait for the other parity
+        ReaderSlot& slot = reader_slots[per_thread_counter_slot() % READER_SLOTS];
+        uint64_t parity;
+        while (true) {
+            uint64_t entered = epoch.load();
+            parity = entered & 1;
+            slot.readers[parity].fetch_add(1);
+            if (epoch.load() == entered) {
+                break;
+            }
+            slot.readers[parity].fetch_sub(1, std::memory_order_release);
+        }
+
+        uint64_t newest = current.load();
+        Generation* generation = ring[newest % options.generations].load();
+        bool duplicate = false;
+        bool rotate_due = false;
+        uint8_t present;
+        for (size_t age = 1; age < options.generations && !duplicate; age++) {
+            Generation* older = ring[(newest - age) % options.generations].load();
+            duplicate = older->keys.get(key, present);
+        }
+        if (!duplicate) {
+            bool recorded = false;
+            generation->keys.get_or_compute(key, [&recorded] {
+                recorded = true;
+                return uint8_t{1};
+            });
+            duplicate = !recorded;
+            if (recorded) {
+                size_t inserted = generation->inserted.fetch_add(1, std::memory_order_relaxed) + 1;
+                rotate_due = (options.keys_per_generation != 0 && inserted >= options.keys_per_generation) ||
+                             now_ns() >= rotate_after_ns.load(std::memory_order_relaxed);
+            }
+        }
+
+        // The generation may be freed once we leave; rotate outside the section
+        // since rotation waits for readers
+        slot.readers[parity].fetch_sub(1, std::memory_order_release);
+        if (rotate_due) {
+            rotate_from(newest);
+        }
+        return duplicate;
+    }
+
+    // Start a new generation now, dropping the oldest
+    void rotate() {
+        std::lock_guard<std::mutex> guard(rotation_mutex);
+        rotate_locked();
+    }
+
+    // Rotations so far (count-, time-based or explicit)
+    uint64_t rotations() const {
+        return rotation_count.load(std::memory_order_relaxed);
+    }
+};
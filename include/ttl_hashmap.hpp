@@ -0,0 +1,405 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "lockfree_hashmap.hpp"
+#include "op_counters.hpp"
+
+// Cache-oriented LockFreeHashMap whose entries expire. Every entry carries an
+// absolute deadline and get() treats entries past it as absent, so expiry is
+// exact to the clock no matter when the entry is actually removed.
+//
+// Removal is driven by hierarchical timing wheels instead of sweeps of the
+// map: insert() files a timer for the key in the wheel of the calling thread's
+// shard, and expire() advances every wheel to the current tick, collecting the
+// due keys in batches and deleting them with remove_if() (an entry re-inserted
+// with a later deadline in the meantime is left alone). Work per expire() is
+// proportional to the timers that fire, not to the size of the map.
+//
+// expire() also unlinks every deleted node in the due keys' buckets - expired
+// entries and the copies insert() and remove() tombstoned - and frees the
+// batch once all operations that might still be walking it have finished.
+// Every tombstone lies in the bucket of a key with a pending timer, so memory
+// and chain length track the live entries. Each operation registers in a
+// per-thread reader count for the current epoch parity; expire() flips the
+// epoch and waits for the old parity to drain before freeing.
+//
+// insert() has upsert semantics: the previous copy of the key is deleted, so
+// removing a key can never uncover an older, longer-lived value
+template<typename K, typename V>
+class TtlHashMap {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        V value;
+        int64_t expires_at; // Clock nanoseconds since the clock's epoch
+    };
+
+    struct Options {
+        // Wheel resolution: entries are removed up to one tick after expiry
+        std::chrono::milliseconds tick{10};
+        // Run expire() every tick on a background thread; otherwise the owner
+        // calls expire() itself
+        bool background_expiry = true;
+    };
+
+private:
+    static constexpr size_t SHARDS = 64;
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+    static constexpr size_t LEVELS = 4;
+    // Timers further out than this many ticks park in the top level and are
+    // refiled when they come due
+    static constexpr uint64_t WHEEL_SPAN = uint64_t{1} << (SLOT_BITS * LEVELS);
+
+    struct Timer {
+        K key;
+        uint64_t due_tick;
+    };
+
+    // Hierarchical timing wheel (Varghese & Lauck): level l holds timers due
+    // within SLOTS^(l+1) ticks, slotted by bits [6l, 6l+6) of the due tick.
+    // Crossing a level-l boundary cascades one slot of level l+1 down
+    struct Wheel {
+        std::vector<Timer> slots[LEVELS][SLOTS];
+        uint64_t occupied[LEVELS] = {}; // Bit s set when slot s is non-empty
+        uint64_t current_tick = 0;
+        size_t pending = 0;
+
+        void add(Timer timer, std::vector<Timer>& due) {
+            if (timer.due_tick <= current_tick) {
+                due.push_back(std::move(timer));
+                return;
+            }
+            uint64_t delta = timer.due_tick - current_tick;
+            uint64_t placed_tick = delta < WHEEL_SPAN ? timer.due_tick
+                                                      : current_tick + WHEEL_SPAN - 1;
+            delta = placed_tick - current_tick;
+            size_t level = 0;
+            while (level + 1 < LEVELS && delta >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+                level++;
+            }
+            size_t slot = static_cast<size_t>(placed_tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+            slots[level][slot].push_back(std::move(timer));
+            occupied[level] |= uint64_t{1} << slot;
+            pending++;
+        }
+
+        std::vector<Timer> take(size_t level, size_t slot) {
+            std::vector<Timer> timers = std::move(slots[level][slot]);
+            slots[level][slot].clear();
+            occupied[level] &= ~(uint64_t{1} << slot);
+            pending -= timers.size();
+            return timers;
+        }
+
+        bool empty() const {
+            return pending == 0;
+        }
+
+        // Move to target_tick, appending every timer due by then to `due`
+        void advance(uint64_t target_tick, std::vector<Timer>& due) {
+            while (current_tick < target_tick) {
+                if (empty()) {
+                    current_tick = target_tick;
+                    return;
+                }
+                if (occupied[0] == 0) {
+                    // Nothing in level 0: jump to just before the next cascade
+                    uint64_t boundary = (current_tick | (SLOTS - 1)) + 1;
+                    if (target_tick < boundary) {
+                        current_tick = target_tick;
+                        return;
+                    }
+                    current_tick = boundary - 1;
+                }
+
+                current_tick++;
+                for (size_t level = 1; level < LEVELS; level++) {
+                    if ((current_tick & ((uint64_t{1} << (SLOT_BITS * level)) - 1)) != 0) {
+                        break;
+                    }
+                    size_t slot = static_cast<size_t>(current_tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+                    for (Timer& timer : take(level, slot)) {
+                        add(std::move(timer), due);
+                    }
+                }
+                for (Timer& timer : take(0, static_cast<size_t>(current_tick) & (SLOTS - 1))) {
+                    add(std::move(timer), due); // Parked far-future timers are refiled
+                }
+            }
+        }
+    };
+
+    struct alignas(64) Shard {
+        std::mutex lock; // Uncontended except while expire() visits the shard
+        Wheel wheel;
+    };
+
+    static constexpr size_t READER_SLOTS = 64;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> readers[2] = {};
+    };
+
+    LockFreeHashMap<K, Entry> map;
+    Options options;
+    int64_t tick_ns;
+    std::unique_ptr<Shard[]> shards;
+
+    std::mutex expiry_mutex; // One expire() at a time
+    std::atomic<uint64_t> expired_total{0};
+    std::atomic<uint64_t> reclaimed_total{0};
+
+    std::atomic<uint64_t> epoch{0};
+    std::unique_ptr<ReaderSlot[]> reader_slots;
+
+    // Registers an operation under the current epoch parity for its duration.
+    // The epoch is re-checked after registering so a concurrent flip cannot
+    // leave the operation counted under the parity expire() no longer waits on
+    class ReadGuard {
+    private:
+        std::atomic<uint64_t>* counter;
+
+    public:
+        explicit ReadGuard(const TtlHashMap& owner) {
+            ReaderSlot& slot = owner.reader_slots[per_thread_counter_slot() % READER_SLOTS];
+            while (true) {
+                uint64_t entered = owner.epoch.load();
+                counter = &slot.readers[entered & 1];
+                counter->fetch_add(1);
+                if (owner.epoch.load() == entered) {
+                    break;
+                }
+                counter->fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        ~ReadGuard() {
+            counter->fetch_sub(1, std::memory_order_release);
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    // Return once every operation that started before the call has finished
+    void wait_for_readers() {
+        uint64_t old_parity = epoch.fetch_add(1) & 1;
+        for (size_t i = 0; i < READER_SLOTS; i++) {
+            while (reader_slots[i].readers[old_parity].load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool expire_now(const K& key) {
+        int64_t now = now_ns();
+        return map.remove_if(key, [now](const Entry& entry) { return entry.expires_at <= now; });
+    }
+
+    std::mutex state_mutex;
+    std::condition_variable expirer_wakeup;
+    bool stopping = false;
+    std::thread expirer;
+
+    thread_local static size_t thread_index;
+    static std::atomic<size_t> thread_counter;
+
+    static size_t shard_index() {
+        if (thread_index == SIZE_MAX) {
+            thread_index = thread_counter.fetch_add(1, std::memory_order_relaxed);
+        }
+        return thread_index % SHARDS;
+    }
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now().time_since_epoch()).count();
+    }
+
+    // First tick at or after the deadline, so a timer never fires early
+    uint64_t tick_of(int64_t deadline) const {
+        return static_cast<uint64_t>((deadline + tick_ns - 1) / tick_ns);
+    }
+
+    void expirer_loop() {
+        std::unique_lock<std::mutex> guard(state_mutex);
+        while (!stopping) {
+            expirer_wakeup.wait_for(guard, options.tick, [&] { return stopping; });
+            guard.unlock();
+            expire();
+            guard.lock();
+        }
+    }
+
+public:
+    explicit TtlHashMap(size_t bucket_count = 1024, Options opts = Options())
+        : map(bucket_count), options(opts), shards(new Shard[SHARDS]),
+          reader_slots(new ReaderSlot[READER_SLOTS]) {
+        if (options.tick.count() <= 0) {
+            throw std::invalid_argument("TtlHashMap tick must be positive");
+        }
+        tick_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(options.tick).count();
+        uint64_t start = static_cast<uint64_t>(now_ns() / tick_ns);
+        for (size_t i = 0; i < SHARDS; i++) {
+            shards[i].wheel.current_tick = start;
+        }
+        if (options.background_expiry) {
+            expirer = std::thread(&TtlHashMap::expirer_loop, this);
+        }
+    }
+
+    ~TtlHashMap() {
+        if (expirer.joinable()) {
+            {
+                std::lock_guard<std::mutex> guard(state_mutex);
+                stopping = true;
+                expirer_wakeup.notify_one();
+            }
+            expirer.join();
+        }
+    }
+
+    TtlHashMap(const TtlHashMap&) = delete;
+    TtlHashMap& operator=(const TtlHashMap&) = delete;
+
+    // Insert or replace key, visible to get() for ttl from now
+    bool insert(const K& key, const V& value, Clock::duration ttl) {
+        int64_t deadline = now_ns() + std::chrono::duration_cast<std::chrono::nanoseconds>(ttl).count();
+        ReadGuard guard(*this);
+        map.insert(key, Entry{value, deadline});
+        map.remove_shadowed(key);
+
+        Shard& shard = shards[shard_index()];
+        std::vector<Timer> due;
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            shard.wheel.add(Timer{key, tick_of(deadline)}, due);
+        }
+        for (const Timer& timer : due) {
+            expire_now(timer.key); // Zero or negative ttl
+        }
+        return true;
+    }
+
+    // Misses once the entry's deadline has passed, removed or not
+    bool get(const K& key, V& value) const {
+        ReadGuard guard(*this);
+        Entry entry;
+        if (!map.get(key, entry) || entry.expires_at <= now_ns()) {
+            return false;
+        }
+        value = entry.value;
+        return true;
+    }
+
+    // Time left before key expires, if it is present
+    bool time_to_live(const K& key, Clock::duration& remaining) const {
+        ReadGuard guard(*this);
+        Entry entry;
+        int64_t now = now_ns();
+        if (!map.get(key, entry) || entry.expires_at <= now) {
+            return false;
+        }
+        remaining = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::nanoseconds(entry.expires_at - now));
+        return true;
+    }
+
+    // Removes every copy of key; its pending timer fires later as a no-op
+    bool remove(const K& key) {
+        ReadGuard guard(*this);
+        bool removed = false;
+        while (map.remove(key)) {
+            removed = true;
+        }
+        return removed;
+    }
+
+    // Delete key if its newest copy has expired
+    bool expire_key(const K& key) {
+        ReadGuard guard(*this);
+        return expire_now(key);
+    }
+
+    // Advance every shard's wheel to the current tick and delete the entries
+    // whose timers fired. Each shard is locked only while its due timers are
+    // collected; the deletes run afterwards. The deleted nodes of the due
+    // keys' buckets are then unlinked and freed as one batch. Only expire()
+    // frees nodes, so it needs no ReadGuard itself. Returns the number deleted
+    size_t expire() {
+        std::lock_guard<std::mutex> serial(expiry_mutex);
+        uint64_t target_tick = static_cast<uint64_t>(now_ns() / tick_ns);
+        std::vector<Timer> due;
+        typename LockFreeHashMap<K, Entry>::UnlinkedNodes unlinked;
+        size_t removed = 0;
+
+        for (size_t i = 0; i < SHARDS; i++) {
+            Shard& shard = shards[i];
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                shard.wheel.advance(target_tick, due);
+            }
+            for (const Timer& timer : due) {
+                if (expire_now(timer.key)) {
+                    removed++;
+                }
+                map.unlink_deleted(timer.key, unlinked);
+            }
+            due.clear();
+        }
+        if (unlinked.size() != 0) {
+            wait_for_readers();
+            reclaimed_total.fetch_add(unlinked.size(), std::memory_order_relaxed);
+            unlinked.clear();
+        }
+        expired_total.fetch_add(removed, std::memory_order_relaxed);
+        return removed;
+    }
+
+    // Timers filed but not yet fired (approximate while writers run)
+    size_t pending_timers() const {
+        size_t total = 0;
+        for (size_t i = 0; i < SHARDS; i++) {
+            std::lock_guard<std::mutex> guard(shards[i].lock);
+            total += shards[i].wheel.pending;
+        }
+        return total;
+    }
+
+    // Entries deleted by expire() so far
+    uint64_t expired_count() const {
+        return expired_total.load(std::memory_order_relaxed);
+    }
+
+    // Nodes unlinked and freed by expire() so far (expired entries plus the
+    // copies tombstoned by insert() and remove())
+    uint64_t reclaimed_count() const {
+        return reclaimed_total.load(std::memory_order_relaxed);
+    }
+
+    // For stats() and the metrics exporter. Walks the chains without a
+    // ReadGuard, so only call it while expire() cannot run
+    const LockFreeHashMap<K, Entry>& underlying() const {
+        return map;
+    }
+};
+
+// Static member initialization
+template<typename K, typename V>
+thread_local size_t TtlHashMap<K, V>::thread_index = SIZE_MAX;
+
+template<typename K, typename V>
+std::atomic<size_t> TtlHashMap<K, V>::thread_counter{0};
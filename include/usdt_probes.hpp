@@ -0,0 +1,79 @@
+#pragma once
+
+// Optional USDT (SystemTap SDT) static tracepoints
+// Define LOCKFREE_HASHMAP_ENABLE_USDT to emit them. Each probe site compiles to a
+// single nop plus a .note.stapsdt entry in the same format <sys/sdt.h> and
+// DTRACE_PROBE produce, so bpftrace/perf/SystemTap can attach with e.g.
+//   bpftrace -e 'usdt:./app:lockfree_hashmap:long_chain { @[arg1] = count(); }'
+// No runtime library or header is needed, and an unattached probe costs a nop
+// plus materialising its (cheap, integer) arguments.
+//
+// Arguments are passed as signed 64-bit values. Probes compile to nothing when
+// the macro is undefined or the target is not ELF on x86-64/AArch64
+#if defined(LOCKFREE_HASHMAP_ENABLE_USDT) && defined(__linux__) && \
+    (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__aarch64__))
+#define LFHM_USDT_ACTIVE 1
+#endif
+
+#ifdef LFHM_USDT_ACTIVE
+
+// Note layout: namesz, descsz, type 3, "stapsdt", then pc, base, semaphore
+// addresses and the provider/name/argument strings. _.stapsdt.base lets tools
+// correct the pc for prelinked binaries, as in <sys/sdt.h>
+#define LFHM_USDT_NOTE(provider, name, arg_format, ...)                                 \
+    __asm__ __volatile__(                                                               \
+        "990: nop\n"                                                                    \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                   \
+        ".balign 4\n"                                                                   \
+        ".4byte 992f-991f, 994f-993f, 3\n"                                              \
+        "991: .asciz \"stapsdt\"\n"                                                     \
+        "992: .balign 4\n"                                                              \
+        "993: .8byte 990b\n"                                                            \
+        ".8byte _.stapsdt.base\n"                                                       \
+        ".8byte 0\n"                                                                    \
+        ".asciz \"" #provider "\"\n"                                                    \
+        ".asciz \"" #name "\"\n"                                                        \
+        ".asciz \"" arg_format "\"\n"                                                   \
+        "994: .balign 4\n"                                                              \
+        ".popsection\n"                                                                 \
+        ".ifndef _.stapsdt.base\n"                                                      \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"         \
+        ".weak _.stapsdt.base\n"                                                        \
+        ".hidden _.stapsdt.base\n"                                                      \
+        "_.stapsdt.base: .space 1\n"                                                    \
+        ".size _.stapsdt.base, 1\n"                                                     \
+        ".popsection\n"                                                                 \
+        ".endif\n"                                                                      \
+        :: __VA_ARGS__)
+
+#define LFHM_USDT_ARG(operand, value) [operand] "nor"(static_cast<long long>(value))
+
+#define LFHM_PROBE0(name) \
+    LFHM_USDT_NOTE(lockfree_hashmap, name, "")
+#define LFHM_PROBE1(name, x0) \
+    LFHM_USDT_NOTE(lockfree_hashmap, name, "-8@%[a0]", LFHM_USDT_ARG(a0, x0))
+#define LFHM_PROBE2(name, x0, x1) \
+    LFHM_USDT_NOTE(lockfree_hashmap, name, "-8@%[a0] -8@%[a1]", \
+                   LFHM_USDT_ARG(a0, x0), LFHM_USDT_ARG(a1, x1))
+#define LFHM_PROBE3(name, x0, x1, x2) \
+    LFHM_USDT_NOTE(lockfree_hashmap, name, "-8@%[a0] -8@%[a1] -8@%[a2]", \
+                   LFHM_USDT_ARG(a0, x0), LFHM_USDT_ARG(a1, x1), LFHM_USDT_ARG(a2, x2))
+
+#define LFHM_IF_PROBES(...) __VA_ARGS__
+
+#else
+
+#define LFHM_PROBE0(name) ((void)0)
+#define LFHM_PROBE1(name, x0) ((void)0)
+#define LFHM_PROBE2(name, x0, x1) ((void)0)
+#define LFHM_PROBE3(name, x0, x1, x2) ((void)0)
+
+#define LFHM_IF_PROBES(...)
+
+#endif
+
+// Chain walks at least this long fire the long_chain probe
+#ifndef LOCKFREE_HASHMAP_LONG_CHAIN_PROBE_THRESHOLD
+#define LOCKFREE_HASHMAP_LONG_CHAIN_PROBE_THRESHOLD 64
+#endif
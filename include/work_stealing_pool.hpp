@@ -0,0 +1,386 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Chase-Lev work-stealing deque of task pointers: the owning thread pushes
+// and pops at the bottom, other threads steal from the top. The ring doubles
+// when full; outgrown rings are kept until the deque is destroyed because a
+// thief may still be reading one
+template<typename T>
+class WorkStealingDeque {
+private:
+    struct Ring {
+        size_t capacity;
+        std::unique_ptr<std::atomic<T*>[]> slots;
+        std::unique_ptr<Ring> previous;
+
+        explicit Ring(size_t size) : capacity(size), slots(new std::atomic<T*>[size]) {}
+
+        T* get(int64_t index) const {
+            return slots[static_cast<size_t>(index) & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, T* item) {
+            slots[static_cast<size_t>(index) & (capacity - 1)].store(item, std::memory_order_relaxed);
+        }
+    };
+
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    std::atomic<Ring*> ring;
+    std::unique_ptr<Ring> owned_ring;
+
+    Ring* grow(Ring* old, int64_t first, int64_t last) {
+        std::unique_ptr<Ring> bigger(new Ring(old->capacity * 2));
+        for (int64_t i = first; i < last; i++) {
+            bigger->put(i, old->get(i));
+        }
+        bigger->previous = std::move(owned_ring);
+        owned_ring = std::move(bigger);
+        ring.store(owned_ring.get(), std::memory_order_release);
+        return owned_ring.get();
+    }
+
+public:
+    explicit WorkStealingDeque(size_t initial_capacity = 256)
+        : owned_ring(new Ring(initial_capacity)) {
+        ring.store(owned_ring.get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only
+    void push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Ring* current = ring.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(current->capacity) - 1) {
+            current = grow(current, t, b);
+        }
+        current->put(b, item);
+        bottom.store(b + 1, std::memory_order_release); // Publishes the item to steal()
+    }
+
+    // Owner only; nullptr when empty
+    T* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* current = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = current->get(b);
+        if (t == b) {
+            // Last item: race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread; nullptr when empty or when another thread won the race
+    T* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        T* item = ring.load(std::memory_order_acquire)->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+};
+
+// Fixed set of worker threads with one WorkStealingDeque each. run(count, fn)
+// forks fn(0) .. fn(count - 1) as tasks and joins them: a worker pushes them
+// onto its own deque, any other thread onto a shared injection queue, and
+// idle workers steal. The calling thread runs fn(0) itself and then keeps
+// executing queued tasks until its group finishes, so run() may be nested
+// inside tasks without deadlocking. Idle workers sleep on a condition variable
+//
+// Bulk operations use default_pool() unless the calling thread is a worker of
+// another pool or has installed one with WorkStealingPool::Scope
+class WorkStealingPool {
+private:
+    struct Task {
+        virtual void execute() = 0;
+
+    protected:
+        ~Task() = default;
+    };
+
+    // One run() call: its tasks, completion count and first failure
+    template<typename F>
+    struct Group {
+        struct Item final : Task {
+            Group* group;
+            size_t index;
+
+            void execute() override {
+                std::exception_ptr failure;
+                try {
+                    (*group->fn)(index);
+                } catch (...) {
+                    failure = std::current_exception();
+                }
+                // Under the mutex so run() cannot return and free the group
+                // before this thread is done with it
+                std::lock_guard<std::mutex> guard(group->mutex);
+                if (failure && !group->error) {
+                    group->error = failure;
+                }
+                if (group->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    group->finished.notify_all();
+                }
+            }
+        };
+
+        F* fn;
+        std::vector<Item> items;
+        std::atomic<size_t> remaining;
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+
+        Group(F& function, size_t count) : fn(&function), items(count), remaining(count) {
+            for (size_t i = 0; i < count; i++) {
+                items[i].group = this;
+                items[i].index = i;
+            }
+        }
+    };
+
+    struct alignas(64) Worker {
+        WorkStealingDeque<Task> deque;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex injection_mutex;
+    std::deque<Task*> injection;
+    std::atomic<size_t> injected{0};  // injection.size(), readable without the lock
+
+    std::atomic<size_t> queued{0};   // Tasks pushed and not yet taken
+    std::atomic<size_t> sleeping{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    struct ThreadState {
+        WorkStealingPool* pool = nullptr;   // Pool this thread works for
+        size_t worker = 0;
+        WorkStealingPool* scoped = nullptr; // Installed by Scope
+        uint64_t steal_seed = 0x9E3779B97F4A7C15ULL;
+    };
+
+    static ThreadState& thread_state() {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    Worker* current_worker() const {
+        ThreadState& state = thread_state();
+        return state.pool == this ? workers[state.worker].get() : nullptr;
+    }
+
+    void announce(size_t count) {
+        queued.fetch_add(count);
+        if (sleeping.load() != 0) {
+            std::lock_guard<std::mutex> guard(sleep_mutex);
+            if (count == 1) {
+                wake.notify_one();
+            } else {
+                wake.notify_all();
+            }
+        }
+    }
+
+    Task* take_injected() {
+        std::lock_guard<std::mutex> guard(injection_mutex);
+        if (injection.empty()) {
+            return nullptr;
+        }
+        Task* task = injection.front();
+        injection.pop_front();
+        injected.store(injection.size(), std::memory_order_relaxed);
+        return task;
+    }
+
+    // Own deque, then the injection queue, then one pass over the others
+    Task* find_task(Worker* self) {
+        Task* task = self != nullptr ? self->deque.pop() : nullptr;
+        if (task == nullptr && injected.load(std::memory_order_relaxed) != 0) {
+            task = take_injected();
+        }
+        if (task == nullptr && !workers.empty()) {
+            uint64_t& seed = thread_state().steal_seed;
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            size_t start = static_cast<size_t>(seed % workers.size());
+            for (size_t i = 0; i < workers.size() && task == nullptr; i++) {
+                Worker* victim = workers[(start + i) % workers.size()].get();
+                if (victim != self) {
+                    task = victim->deque.steal();
+                }
+            }
+        }
+        if (task != nullptr) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    void worker_loop(size_t index) {
+        ThreadState& state = thread_state();
+        state.pool = this;
+        state.worker = index;
+        state.steal_seed += index;
+        Worker* self = workers[index].get();
+
+        while (true) {
+            Task* task = find_task(self);
+            if (task != nullptr) {
+                task->execute();
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleep_mutex);
+            sleeping.fetch_add(1);
+            while (queued.load() == 0 && !stopping.load()) {
+                wake.wait(guard);
+            }
+            sleeping.fetch_sub(1);
+            if (stopping.load() && queued.load() == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    // threads == 0 uses one worker per hardware thread, less one for the
+    // caller of run(), which works too. A pool of 0 workers runs every task on
+    // the calling thread
+    explicit WorkStealingPool(size_t threads = 0) {
+        if (threads == 0) {
+            size_t hardware = std::thread::hardware_concurrency();
+            threads = hardware > 1 ? hardware - 1 : 0;
+        }
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back(new Worker());
+        }
+        for (size_t i = 0; i < threads; i++) {
+            workers[i]->thread = std::thread(&WorkStealingPool::worker_loop, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> guard(sleep_mutex);
+            stopping.store(true);
+            wake.notify_all();
+        }
+        for (auto& worker : workers) {
+            worker->thread.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t thread_count() const {
+        return workers.size();
+    }
+
+    // Call fn(i) for every i in [0, count), in parallel, and return once all
+    // calls have finished. The first exception thrown is rethrown afterwards
+    template<typename F>
+    void run(size_t count, F&& fn) {
+        if (count == 0) {
+            return;
+        }
+        using Function = std::remove_reference_t<F>;
+        Group<Function> group(fn, count);
+        Worker* self = current_worker();
+
+        if (count > 1) {
+            if (self != nullptr) {
+                for (size_t i = count - 1; i >= 1; i--) {
+                    self->deque.push(&group.items[i]);
+                }
+            } else {
+                std::lock_guard<std::mutex> guard(injection_mutex);
+                for (size_t i = 1; i < count; i++) {
+                    injection.push_back(&group.items[i]);
+                }
+                injected.store(injection.size(), std::memory_order_relaxed);
+            }
+            announce(count - 1);
+        }
+        group.items[0].execute();
+
+        // Help with queued work (ours or anyone's) until the group is done
+        while (group.remaining.load(std::memory_order_acquire) != 0) {
+            Task* task = find_task(self);
+            if (task != nullptr) {
+                task->execute();
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(group.mutex);
+            group.finished.wait(guard, [&group] {
+                return group.remaining.load(std::memory_order_acquire) == 0;
+            });
+        }
+        // The last task may still hold the mutex
+        std::lock_guard<std::mutex> guard(group.mutex);
+
+        if (group.error) {
+            std::rethrow_exception(group.error);
+        }
+    }
+
+    // Makes run_parallel() on this thread use pool until the Scope ends
+    class Scope {
+    private:
+        WorkStealingPool* previous;
+
+    public:
+        explicit Scope(WorkStealingPool& pool) : previous(thread_state().scoped) {
+            thread_state().scoped = &pool;
+        }
+
+        ~Scope() {
+            thread_state().scoped = previous;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // Pool for run_parallel() on this thread: an installed Scope, else the
+    // pool this thread works for, else nullptr
+    static WorkStealingPool* current() {
+        ThreadState& state = thread_state();
+        return state.scoped != nullptr ? state.scoped : state.pool;
+    }
+};
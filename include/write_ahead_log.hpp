@@ -0,0 +1,438 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "lockfree_hashmap.hpp"
+#include "parallel.hpp"
+#include "snapshot.hpp"
+
+// Durability layer around a LockFreeHashMap: every insert/remove appends a
+// record to an in-memory buffer and a background flusher writes all buffers to
+// one log file with a single fdatasync per batch (group commit). A batch is cut
+// after max_batch_delay or once max_batch_bytes are pending, whichever comes
+// first. Writers only wait for the fdatasync when they pass Durability::SYNC.
+//
+// Keys map to STRIPES stripes, each with a lock and its own record buffer. A
+// mutation holds its stripe lock while it updates the map and appends its
+// record, so the records of one key reach the log in the order the map saw
+// them, while writers on different stripes never contend.
+//
+// Mutations have upsert semantics: insert() keeps only the newest copy of a key
+// and remove() deletes every copy, so a snapshot (one value per key) plus the
+// log recovers exactly the live state. Recovery runs in the constructor: load
+// the snapshot, replay the logs on top, then fold them into a new snapshot.
+//
+// Files: <log_path> is the active log; checkpoint() renames it to
+// <log_path>.old, saves the snapshot and unlinks the old log. Every create,
+// rename and unlink is followed by an fsync of the directory, and the old log
+// goes only once the snapshot's rename is durable. Replaying a record whose
+// effect the snapshot already holds is harmless, so a crash at any point
+// leaves files that recover to the same state
+template<typename K, typename V>
+class DurableHashMap {
+public:
+    enum class Durability {
+        ASYNC, // Return once buffered; durable by the next group commit
+        SYNC   // Return after the group commit containing this record
+    };
+
+    struct Options {
+        std::chrono::microseconds max_batch_delay{1000};
+        size_t max_batch_bytes = 4 << 20;
+    };
+
+private:
+    static constexpr size_t STRIPES = 1024;
+    static constexpr char LOG_MAGIC[8] = {'L', 'F', 'H', 'M', 'W', 'A', 'L', '1'};
+
+    enum class Op : uint8_t {
+        INSERT = 1,
+        REMOVE = 2
+    };
+
+    struct alignas(64) Stripe {
+        std::mutex lock;
+        std::string records;              // Not yet handed to a batch
+        std::atomic<bool> dirty{false};   // Lets the flusher skip idle stripes
+    };
+
+    struct Record {
+        uint32_t stripe;
+        Op op;
+        K key;
+        V value;
+    };
+
+    LockFreeHashMap<K, V>& map;
+    std::string log_path;
+    std::string snapshot_path;
+    Options options;
+    std::hash<K> hasher;
+
+    std::unique_ptr<Stripe[]> stripes;
+    std::atomic<size_t> pending_bytes{0};
+
+    std::unique_ptr<SnapshotFile> log;
+    uint64_t log_offset = 0;               // End of the active log
+    std::mutex flush_mutex;                // Serialises batches and log rotation
+    std::mutex checkpoint_mutex;           // One <log_path>.old at a time
+    std::atomic<uint64_t> batches_started{0};
+
+    std::mutex state_mutex;                // Guards the fields below
+    std::condition_variable flusher_wakeup;
+    std::condition_variable batch_durable;
+    uint64_t batches_completed = 0;
+    bool flush_requested = false;
+    bool stopping = false;
+    std::exception_ptr flush_error;
+
+    std::thread flusher;
+
+    size_t stripe_of(const K& key) const {
+        uint64_t h = hasher(key);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h % STRIPES);
+    }
+
+    // Record: u32 payload length, u64 payload checksum, payload
+    // Payload: u8 op, u32 stripe, key[, value]
+    static void append_record(std::string& out, Op op, uint32_t stripe,
+                              const K& key, const V* value) {
+        std::string payload;
+        payload.push_back(static_cast<char>(op));
+        payload.append(reinterpret_cast<const char*>(&stripe), sizeof(stripe));
+        SnapshotSerializer<K>::write(payload, key);
+        if (value != nullptr) {
+            SnapshotSerializer<V>::write(payload, *value);
+        }
+
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        uint64_t checksum = snapshot_checksum(payload.data(), payload.size());
+        out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        out.append(payload);
+    }
+
+    // Parse a log file, stopping quietly at a torn or corrupt tail (what a
+    // crash mid-batch leaves behind). A missing file yields no records
+    static void read_log(const std::string& path, std::vector<Record>& records) {
+        if (::access(path.c_str(), F_OK) != 0) {
+            return;
+        }
+        SnapshotFile file(path, O_RDONLY);
+        uint64_t size = file.size();
+        if (size < sizeof(LOG_MAGIC)) {
+            return;
+        }
+        std::string data(static_cast<size_t>(size), '\0');
+        file.read_at(&data[0], data.size(), 0);
+        if (std::memcmp(data.data(), LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) {
+            throw std::runtime_error(path + " is not a write-ahead log");
+        }
+
+        const char* in = data.data() + sizeof(LOG_MAGIC);
+        const char* end = data.data() + data.size();
+        while (static_cast<size_t>(end - in) >= sizeof(uint32_t) + sizeof(uint64_t)) {
+            uint32_t length;
+            uint64_t checksum;
+            std::memcpy(&length, in, sizeof(length));
+            std::memcpy(&checksum, in + sizeof(length), sizeof(checksum));
+            const char* payload = in + sizeof(length) + sizeof(checksum);
+            if (static_cast<size_t>(end - payload) < length ||
+                snapshot_checksum(payload, length) != checksum) {
+                break;
+            }
+
+            const char* p = payload;
+            const char* payload_end = payload + length;
+            Record record{};
+            uint8_t op;
+            if (length < sizeof(op) + sizeof(record.stripe)) {
+                break;
+            }
+            std::memcpy(&op, p, sizeof(op));
+            p += sizeof(op);
+            std::memcpy(&record.stripe, p, sizeof(record.stripe));
+            p += sizeof(record.stripe);
+            record.op = static_cast<Op>(op);
+
+            bool ok = SnapshotSerializer<K>::read(p, payload_end, record.key);
+            if (ok && record.op == Op::INSERT) {
+                ok = SnapshotSerializer<V>::read(p, payload_end, record.value);
+            }
+            if (!ok || p != payload_end || record.stripe >= STRIPES ||
+                (record.op != Op::INSERT && record.op != Op::REMOVE)) {
+                break;
+            }
+            records.push_back(std::move(record));
+            in = payload_end;
+        }
+    }
+
+    bool remove_all(const K& key) {
+        bool removed = false;
+        while (map.remove(key)) {
+            removed = true;
+        }
+        return removed;
+    }
+
+    void recover() {
+        if (::access(snapshot_path.c_str(), F_OK) == 0) {
+            map.load(snapshot_path);
+        }
+
+        std::vector<Record> records;
+        read_log(log_path + ".old", records);
+        read_log(log_path, records);
+
+        if (!records.empty()) {
+            // Stripes hold disjoint keys, so workers replay stripe ranges in
+            // parallel, each in log order
+            size_t workers = default_parallelism();
+            run_parallel(workers, [&](size_t worker) {
+                uint32_t first = static_cast<uint32_t>(STRIPES * worker / workers);
+                uint32_t last = static_cast<uint32_t>(STRIPES * (worker + 1) / workers);
+                for (const Record& record : records) {
+                    if (record.stripe < first || record.stripe >= last) {
+                        continue;
+                    }
+                    if (record.op == Op::INSERT) {
+                        map.insert(record.key, record.value);
+                        map.remove_shadowed(record.key);
+                    } else {
+                        remove_all(record.key);
+                    }
+                }
+            });
+            map.save(snapshot_path);
+        }
+
+        // Also drops a torn tail, which must not be appended to. save() made
+        // the snapshot durable first, so losing the logs cannot lose records
+        std::remove((log_path + ".old").c_str());
+        std::remove(log_path.c_str());
+    }
+
+    // Also makes a preceding rename of the active log durable, since both
+    // live in the same directory
+    void open_log() {
+        log.reset(new SnapshotFile(log_path, O_WRONLY | O_CREAT | O_TRUNC));
+        log->write_at(LOG_MAGIC, sizeof(LOG_MAGIC), 0);
+        log->sync();
+        sync_parent_directory(log_path);
+        log_offset = sizeof(LOG_MAGIC);
+    }
+
+    // Called with the stripe lock held; returns the batch that will carry the record
+    uint64_t buffer_record(Stripe& stripe, Op op, size_t index, const K& key, const V* value) {
+        size_t before = stripe.records.size();
+        append_record(stripe.records, op, static_cast<uint32_t>(index), key, value);
+        size_t added = stripe.records.size() - before;
+        stripe.dirty.store(true);
+
+        if (pending_bytes.fetch_add(added) + added >= options.max_batch_bytes) {
+            request_flush();
+        }
+        // dirty is stored before this read and loaded by flush_batch after its
+        // increment (all seq_cst), so the batch that follows the value read here
+        // sees the stripe dirty and takes our record
+        return batches_started.load() + 1;
+    }
+
+    void request_flush() {
+        std::lock_guard<std::mutex> guard(state_mutex);
+        flush_requested = true;
+        flusher_wakeup.notify_one();
+    }
+
+    void wait_durable(uint64_t batch) {
+        std::unique_lock<std::mutex> guard(state_mutex);
+        flush_requested = true;
+        flusher_wakeup.notify_one();
+        batch_durable.wait(guard, [&] { return batches_completed >= batch || flush_error; });
+        if (flush_error) {
+            std::rethrow_exception(flush_error);
+        }
+    }
+
+    // One group commit; with rotate set the active log then becomes
+    // <log_path>.old and a fresh active log is opened
+    void flush_batch(bool rotate) {
+        std::lock_guard<std::mutex> flush_guard(flush_mutex);
+        uint64_t batch = batches_started.fetch_add(1) + 1;
+
+        std::string batch_records;
+        for (size_t i = 0; i < STRIPES; i++) {
+            if (!stripes[i].dirty.load()) {
+                continue;
+            }
+            std::lock_guard<std::mutex> guard(stripes[i].lock);
+            batch_records += stripes[i].records;
+            stripes[i].records.clear();
+            stripes[i].dirty.store(false);
+        }
+        pending_bytes.fetch_sub(batch_records.size());
+
+        std::exception_ptr error;
+        try {
+            if (!batch_records.empty()) {
+                log->write_at(batch_records.data(), batch_records.size(), log_offset);
+                log_offset += batch_records.size();
+                if (::fdatasync(log->descriptor()) != 0) {
+                    throw std::runtime_error("cannot fdatasync " + log_path + ": " +
+                                             std::strerror(errno));
+                }
+            }
+            if (rotate) {
+                if (std::rename(log_path.c_str(), (log_path + ".old").c_str()) != 0) {
+                    throw std::runtime_error("cannot rename " + log_path + ": " +
+                                             std::strerror(errno));
+                }
+                open_log();
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> guard(state_mutex);
+        batches_completed = batch;
+        if (error && !flush_error) {
+            flush_error = error;
+        }
+        batch_durable.notify_all();
+        if (error && rotate) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void flusher_loop() {
+        std::unique_lock<std::mutex> guard(state_mutex);
+        while (!stopping) {
+            flusher_wakeup.wait_for(guard, options.max_batch_delay,
+                                    [&] { return flush_requested || stopping; });
+            flush_requested = false;
+            guard.unlock();
+            flush_batch(false);
+            guard.lock();
+        }
+    }
+
+    void check_error() {
+        std::lock_guard<std::mutex> guard(state_mutex);
+        if (flush_error) {
+            std::rethrow_exception(flush_error);
+        }
+    }
+
+public:
+    // Recover `target` from snapshot_file and the logs at log_file, then start
+    // logging. `target` should be empty and must outlive this object; all
+    // mutations must go through this wrapper from now on
+    DurableHashMap(LockFreeHashMap<K, V>& target, const std::string& log_file,
+                   const std::string& snapshot_file, Options opts = Options())
+        : map(target), log_path(log_file), snapshot_path(snapshot_file), options(opts),
+          stripes(new Stripe[STRIPES]) {
+        static_assert(SnapshotSerializer<K>::available && SnapshotSerializer<V>::available,
+                      "DurableHashMap needs a SnapshotSerializer specialisation for K and V");
+        recover();
+        open_log();
+        flusher = std::thread(&DurableHashMap::flusher_loop, this);
+    }
+
+    // Commits everything still buffered before returning
+    ~DurableHashMap() {
+        {
+            std::lock_guard<std::mutex> guard(state_mutex);
+            stopping = true;
+            flusher_wakeup.notify_one();
+        }
+        flusher.join();
+        try {
+            flush_batch(false);
+        } catch (...) {
+        }
+    }
+
+    DurableHashMap(const DurableHashMap&) = delete;
+    DurableHashMap& operator=(const DurableHashMap&) = delete;
+
+    // Throws std::runtime_error once a group commit has failed
+    bool insert(const K& key, const V& value, Durability durability = Durability::ASYNC) {
+        check_error();
+        size_t index = stripe_of(key);
+        Stripe& stripe = stripes[index];
+        uint64_t batch;
+        {
+            std::lock_guard<std::mutex> guard(stripe.lock);
+            map.insert(key, value);
+            map.remove_shadowed(key);
+            batch = buffer_record(stripe, Op::INSERT, index, key, &value);
+        }
+        if (durability == Durability::SYNC) {
+            wait_durable(batch);
+        }
+        return true;
+    }
+
+    // Removes every copy of key; only successful removes are logged
+    bool remove(const K& key, Durability durability = Durability::ASYNC) {
+        check_error();
+        size_t index = stripe_of(key);
+        Stripe& stripe = stripes[index];
+        uint64_t batch;
+        {
+            std::lock_guard<std::mutex> guard(stripe.lock);
+            if (!remove_all(key)) {
+                return false;
+            }
+            batch = buffer_record(stripe, Op::REMOVE, index, key, nullptr);
+        }
+        if (durability == Durability::SYNC) {
+            wait_durable(batch);
+        }
+        return true;
+    }
+
+    bool get(const K& key, V& value) const {
+        return map.get(key, value);
+    }
+
+    // Wait until every mutation that returned before this call is durable
+    void sync() {
+        wait_durable(batches_started.load() + 1);
+    }
+
+    // Save a new snapshot and drop the log it covers. Writers keep running;
+    // they only wait for the stripe locks while the last batch is collected
+    void checkpoint() {
+        std::lock_guard<std::mutex> guard(checkpoint_mutex);
+        flush_batch(true);
+        map.save(snapshot_path);   // Returns once the rename is durable
+        std::remove((log_path + ".old").c_str());
+        sync_parent_directory(log_path);
+    }
+
+    const LockFreeHashMap<K, V>& underlying() const {
+        return map;
+    }
+};
@@ -0,0 +1,31 @@
+# Check that BINARY (built with LOCKFREE_HASHMAP_ENABLE_USDT) carries a usable
+# .note.stapsdt entry for every probe: provider lockfree_hashmap, the probe
+# name, a non-zero location and one -8@ operand per argument
+#
+#   cmake -DREADELF=readelf -DBINARY=path -P check_usdt_notes.cmake
+
+execute_process(COMMAND ${READELF} -n ${BINARY}
+                OUTPUT_VARIABLE notes
+                RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "${READELF} -n ${BINARY} failed")
+endif()
+
+# Probe name and argument count
+set(probes "long_chain:2" "insert_cas_retry:2" "reclaim_start:1" "reclaim_end:2")
+
+foreach(probe IN LISTS probes)
+    string(REPLACE ":" ";" parts "${probe}")
+    list(GET parts 0 name)
+    list(GET parts 1 arguments)
+    set(operands "-8@[^ \n]+")
+    while(arguments GREATER 1)
+        string(APPEND operands " -8@[^ \n]+")
+        math(EXPR arguments "${arguments} - 1")
+    endwhile()
+    if(NOT notes MATCHES
+       "Provider: lockfree_hashmap\n[ \t]*Name: ${name}\n[ \t]*Location: 0x0*[1-9a-f][0-9a-f]*, Base: 0x[0-9a-f]+, Semaphore: 0x0+\n[ \t]*Arguments: ${operands}\n")
+        message(FATAL_ERROR "no usable stapsdt note for lockfree_hashmap:${name} in ${BINARY}")
+    endif()
+    message(STATUS "lockfree_hashmap:${name} ok")
+endforeach()
@@ -0,0 +1,144 @@
+#include "lockfree_hashmap.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+// BufferedWriter: a random insert/remove sequence ends in the same state as
+// applying it to the map directly, nothing is visible before a flush, a
+// mutation feed sees the operations in order, and several writers flush
+// into one map while readers run
+using Feed = MutationFeed<int, int>;
+
+int main() {
+    std::cout << "BufferedWriter Test\n";
+    std::cout << "===================\n\n";
+
+    // Same final state as unbuffered operations, for several buffer sizes
+    for (size_t buffer_size : {1, 7, 64, 4096}) {
+        constexpr int KEYS = 300;
+        LockFreeHashMap<int, int> direct(64);
+        LockFreeHashMap<int, int> buffered(64);
+        std::mt19937 rng(static_cast<unsigned>(buffer_size));
+        for (int key = 0; key < KEYS; key += 3) {
+            direct.insert(key, -key); // Published copies for removes to find
+            buffered.insert(key, -key);
+        }
+        {
+            auto writer = buffered.buffered_writer(buffer_size);
+            for (int op = 0; op < 20000; op++) {
+                int key = static_cast<int>(rng() % KEYS);
+                if (rng() % 3 == 0) {
+                    direct.remove(key);
+                    writer.remove(key);
+                } else {
+                    direct.insert(key, op);
+                    writer.insert(key, op);
+                }
+            }
+        }
+        bool same = true;
+        for (int key = 0; key < KEYS; key++) {
+            int expected = 0;
+            int actual = 0;
+            bool in_direct = direct.get(key, expected);
+            bool in_buffered = buffered.get(key, actual);
+            same &= in_direct == in_buffered && (!in_direct || expected == actual);
+        }
+        CHECK(same);
+    }
+
+    // Buffered operations stay invisible until flush()
+    {
+        LockFreeHashMap<int, int> map(16);
+        map.insert(1, 1);
+        auto writer = map.buffered_writer(100);
+        writer.insert(2, 2);
+        writer.remove(1);
+        CHECK(writer.buffered() == 2);
+        int value = 0;
+        CHECK(!map.get(2, value));
+        CHECK(map.get(1, value) && value == 1);
+        writer.flush();
+        CHECK(writer.buffered() == 0);
+        CHECK(map.get(2, value) && value == 2);
+        CHECK(!map.get(1, value));
+    }
+
+    // A feed receives each key's records in operation order
+    {
+        LockFreeHashMap<int, int> map(16);
+        Feed feed(1 << 10);
+        map.set_mutation_feed(&feed);
+        map.insert(5, 0);
+        {
+            auto writer = map.buffered_writer(8);
+            writer.insert(5, 1);
+            writer.insert(6, 1);
+            writer.remove(6);
+            writer.insert(5, 2);
+            writer.remove(5);
+        }
+        std::map<int, std::vector<std::pair<Feed::Type, int>>> records;
+        feed.drain([&](const Feed::Mutation& m) { records[m.key].emplace_back(m.type, m.value); });
+        using T = Feed::Type;
+        CHECK((records[5] == std::vector<std::pair<T, int>>{
+            {T::INSERT, 0}, {T::INSERT, 1}, {T::INSERT, 2}, {T::REMOVE, 0}}));
+        CHECK((records[6] == std::vector<std::pair<T, int>>{{T::INSERT, 1}, {T::REMOVE, 0}}));
+        int value = 0;
+        CHECK(map.get(5, value) && value == 1);
+        CHECK(!map.get(6, value));
+    }
+
+    // One writer per thread into a shared map while readers look keys up;
+    // readers only ever see values some writer stored for that key
+    {
+        constexpr int WRITERS = 4;
+        constexpr int KEYS = 20000;
+        LockFreeHashMap<int, int> map(4096);
+        std::atomic<int> writers_left{WRITERS};
+        std::atomic<int> bad_reads{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < WRITERS; t++) {
+            threads.emplace_back([&, t] {
+                auto writer = map.buffered_writer(256);
+                for (int key = 0; key < KEYS; key++) {
+                    // Every writer touches every key; value encodes key and writer
+                    writer.insert(key, key * WRITERS + t);
+                    if (key % 10 == t) {
+                        writer.remove(key);
+                    }
+                }
+                writer.flush();
+                writers_left.fetch_sub(1);
+            });
+        }
+        for (int r = 0; r < 2; r++) {
+            threads.emplace_back([&] {
+                std::mt19937 rng(99);
+                int value = 0;
+                while (writers_left.load() > 0) {
+                    int key = static_cast<int>(rng() % KEYS);
+                    if (map.get(key, value) && value / WRITERS != key) {
+                        bad_reads++;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(bad_reads.load() == 0);
+        bool all_present = true;
+        for (int key = 0; key < KEYS; key++) {
+            int value = -1;
+            all_present &= map.get(key, value) && value / WRITERS == key;
+        }
+        CHECK(all_present);
+    }
+
+    return test_result("BufferedWriter");
+}
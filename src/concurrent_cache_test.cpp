@@ -0,0 +1,150 @@
+#include "concurrent_cache.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ConcurrentCache: bounds and replacement for every policy, oversized
+// inserts, readers racing eviction (run under ASan for the reclamation), and
+// hazard slot reuse across many short-lived threads
+using Cache = ConcurrentCache<int, int>;
+
+int main() {
+    std::cout << "Concurrent Cache Test\n";
+    std::cout << "=====================\n\n";
+
+    for (Cache::Policy policy : {Cache::Policy::CLOCK, Cache::Policy::S3_FIFO, Cache::Policy::W_TINYLFU}) {
+        Cache::Options options;
+        options.policy = policy;
+        options.shards = 4;
+        Cache cache(1000, options);
+        for (int i = 0; i < 20000; i++) {
+            cache.insert(i, i * 2);
+        }
+        CHECK(cache.size() <= 1000);
+        CHECK(cache.evictions() >= 19000);
+        cache.insert(5, 1);
+        cache.insert(5, 2);
+        int value = 0;
+        CHECK(cache.get(5, value) && value == 2);
+        CHECK(cache.remove(5));
+        CHECK(!cache.get(5, value));
+    }
+
+    // An entry too heavy for its shard leaves the key uncached, not stale
+    {
+        Cache::Options options;
+        options.shards = 1;
+        options.weigher = [](const int&, const int& value) { return static_cast<size_t>(value); };
+        Cache cache(100, options);
+        CHECK(cache.insert(1, 10));
+        CHECK(!cache.insert(1, 500));
+        int value = 0;
+        CHECK(!cache.get(1, value));
+        CHECK(cache.charge() == 0);
+    }
+
+    // Readers racing inserts, removes and eviction see only values written
+    {
+        Cache::Options options;
+        options.policy = Cache::Policy::S3_FIFO;
+        Cache cache(512, options);
+        std::atomic<bool> done{false};
+        std::atomic<int> wrong{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 3; t++) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng(t);
+                for (int i = 0; i < 100000; i++) {
+                    int key = static_cast<int>(rng() % 4096);
+                    if (i % 5 == 0) {
+                        cache.remove(key);
+                    } else {
+                        cache.insert(key, key * 2);
+                    }
+                }
+            });
+        }
+        for (int t = 0; t < 3; t++) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng(10 + t);
+                int value = 0;
+                while (!done.load()) {
+                    int key = static_cast<int>(rng() % 4096);
+                    if (cache.get(key, value) && value != key * 2) {
+                        wrong.fetch_add(1);
+                    }
+                }
+            });
+        }
+        for (int t = 0; t < 3; t++) {
+            threads[t].join();
+        }
+        done.store(true);
+        for (int t = 3; t < 6; t++) {
+            threads[t].join();
+        }
+        CHECK(wrong.load() == 0);
+        CHECK(cache.size() <= 512);
+    }
+
+    // Hazard slots are recycled: far more than 128 threads over time is fine,
+    // more than 128 at once is rejected
+    {
+        Cache cache(256);
+        int value = 0;
+        cache.get(0, value); // This thread holds a slot throughout
+        for (int round = 0; round < 10; round++) {
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 50; t++) {
+                threads.emplace_back([&cache, t] {
+                    cache.insert(t, t * 2);
+                    int found = 0;
+                    cache.get(t, found);
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+        CHECK(cache.get(7, value) && value == 14);
+
+        std::atomic<int> holding{0};
+        std::atomic<bool> release{false};
+        std::vector<std::thread> holders;
+        for (int t = 0; t < 127; t++) {
+            holders.emplace_back([&] {
+                int found = 0;
+                cache.get(1, found);
+                holding.fetch_add(1);
+                while (!release.load()) {
+                    std::this_thread::yield();
+                }
+            });
+        }
+        while (holding.load() != 127) {
+            std::this_thread::yield();
+        }
+        bool rejected = false;
+        std::thread extra([&] {
+            try {
+                int found = 0;
+                cache.get(1, found);
+            } catch (const std::runtime_error&) {
+                rejected = true;
+            }
+        });
+        extra.join();
+        release.store(true);
+        for (auto& holder : holders) {
+            holder.join();
+        }
+        CHECK(rejected);
+    }
+
+    return test_result("concurrent_cache_test");
+}
@@ -0,0 +1,99 @@
+#include "concurrent_interner.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ConcurrentInterner: dense ids in first-intern order, round trips through
+// lookup(), strings larger than an arena chunk, and threads racing to intern
+// overlapping strings all agreeing on one id each
+int main() {
+    std::cout << "Concurrent Interner Test\n";
+    std::cout << "========================\n\n";
+
+    // Sequential: ids are 0, 1, 2, ... and repeat for known strings
+    {
+        ConcurrentInterner interner(1024);
+        CHECK(interner.intern("alpha") == 0);
+        CHECK(interner.intern("beta") == 1);
+        CHECK(interner.intern("alpha") == 0);
+        CHECK(interner.intern("") == 2);
+        CHECK(interner.size() == 3);
+        CHECK(interner.lookup(1) == "beta");
+        CHECK(interner.lookup(2).empty());
+
+        uint32_t id = 0;
+        CHECK(interner.find("beta", id) && id == 1);
+        CHECK(!interner.find("gamma", id));
+        CHECK(interner.size() == 3);
+
+        bool threw = false;
+        try {
+            interner.lookup(3);
+        } catch (const std::out_of_range&) {
+            threw = true;
+        }
+        CHECK(threw);
+
+        // Long strings and many ids cross chunk and segment boundaries
+        std::string big(3 << 20, 'z');
+        uint32_t big_id = interner.intern(big);
+        CHECK(interner.lookup(big_id) == big);
+        bool round_trips = true;
+        for (int i = 0; i < 100000; i++) {
+            std::string text = "s" + std::to_string(i);
+            round_trips &= interner.lookup(interner.intern(text)) == text;
+        }
+        CHECK(round_trips);
+        CHECK(interner.size() == 100004);
+        CHECK(interner.lookup(0) == "alpha");
+        CHECK(interner.arena_bytes() >= big.size());
+    }
+
+    // Racing threads intern overlapping strings: each string gets one id, the
+    // ids are exactly 0 .. size() - 1, and every thread saw the same id
+    {
+        constexpr int THREADS = 8;
+        constexpr int STRINGS = 20000;
+        ConcurrentInterner interner(1024);
+        std::vector<std::vector<uint32_t>> ids(THREADS, std::vector<uint32_t>(STRINGS));
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < STRINGS; i++) {
+                    // Each thread starts elsewhere; odd threads walk backwards
+                    int s = (t % 2 == 0 ? i + t * 2503 : STRINGS - 1 - i + t * 2503) % STRINGS;
+                    ids[t][s] = interner.intern("key-" + std::to_string(s));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        CHECK(interner.size() == STRINGS);
+        bool agree = true;
+        std::vector<int> owners(STRINGS, 0);
+        for (int s = 0; s < STRINGS; s++) {
+            for (int t = 1; t < THREADS; t++) {
+                agree &= ids[t][s] == ids[0][s];
+            }
+            if (ids[0][s] < STRINGS) {
+                owners[ids[0][s]]++;
+            }
+            agree &= interner.lookup(ids[0][s]) == "key-" + std::to_string(s);
+        }
+        CHECK(agree);
+        bool dense = true;
+        for (int owner : owners) {
+            dense &= owner == 1;
+        }
+        CHECK(dense);
+    }
+
+    return test_result("Concurrent interner");
+}
@@ -0,0 +1,86 @@
+#include "lockfree_hashmap.hpp"
+#include "test_check.hpp"
+#include <iostream>
+#include <optional>
+#include <vector>
+
+// get_async() and interleave_lookups() (C++20, built with
+// LOCKFREE_HASHMAP_ENABLE_COUNTERS): every key reports exactly what get()
+// returns, for hits, misses, removed and overwritten keys on long chains, at
+// widths of 1, several, and more than the number of keys; lookups count as GETs
+int main() {
+    std::cout << "Coroutine Lookup Test\n";
+    std::cout << "=====================\n\n";
+
+    constexpr int KEYS = 2000;
+    constexpr int PROBED = 3000; // Keys KEYS .. PROBED - 1 were never inserted
+    LockFreeHashMap<int, int> map(64); // About 30 nodes per chain
+    for (int key = 0; key < KEYS; key++) {
+        map.insert(key, key * 10);
+    }
+    for (int key = 0; key < KEYS; key += 5) {
+        map.remove(key);
+    }
+    for (int key = 1; key < KEYS; key += 7) {
+        map.insert(key, -key); // Newer value shadows the first
+    }
+
+    std::vector<std::optional<int>> expected(PROBED);
+    for (int key = 0; key < PROBED; key++) {
+        int value = 0;
+        if (map.get(key, value)) {
+            expected[key] = value;
+        }
+    }
+
+    // One task driven by hand
+    {
+        bool same = true;
+        for (int key = 0; key < PROBED; key++) {
+            auto task = map.get_async(key);
+            while (!task.done()) {
+                task.resume();
+            }
+            same &= task.result() == expected[key];
+        }
+        CHECK(same);
+    }
+
+    for (size_t width : {size_t{1}, size_t{2}, INTERLEAVED_LOOKUPS, size_t{PROBED + 100}}) {
+        std::vector<std::optional<int>> found(PROBED);
+        std::vector<int> calls(PROBED, 0);
+        interleave_lookups(map, PROBED, [](size_t i) { return static_cast<int>(i); },
+                           [&](size_t i, const int& value) {
+                               found[i] = value;
+                               calls[i]++;
+                           }, width);
+        bool same = true;
+        for (int key = 0; key < PROBED; key++) {
+            same &= found[key] == expected[key] && calls[key] == (expected[key] ? 1 : 0);
+        }
+        CHECK(same);
+    }
+
+    // No keys: nothing is called
+    {
+        int calls = 0;
+        interleave_lookups(map, 0, [](size_t i) { return static_cast<int>(i); },
+                           [&](size_t, const int&) { calls++; });
+        CHECK(calls == 0);
+    }
+
+    // Counted like get()
+    {
+        LockFreeHashMap<int, int> counted(16);
+        counted.insert(1, 1);
+        auto before = counted.op_counters();
+        interleave_lookups(counted, 4, [](size_t i) { return static_cast<int>(i); },
+                           [](size_t, const int&) {});
+        auto after = counted.op_counters();
+        CHECK(after.get_hits - before.get_hits == 1);
+        CHECK(after.get_misses - before.get_misses == 3);
+        CHECK(after.get_nodes_traversed > before.get_nodes_traversed);
+    }
+
+    return test_result("Coroutine lookup");
+}
@@ -0,0 +1,106 @@
+#include "concurrent_cache.hpp"
+#include "frequency_sketch.hpp"
+#include "test_check.hpp"
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// FrequencySketch: counting, saturation at 15, periodic halving, concurrent
+// increments; and W-TinyLFU keeping a hot set through a one-hit scan
+int main() {
+    std::cout << "Frequency Sketch Test\n";
+    std::cout << "=====================\n\n";
+
+    // Counts up to the 4-bit cap and never undercounts
+    {
+        FrequencySketch sketch(1024);
+        CHECK(sketch.estimate(1) == 0);
+        for (int i = 0; i < 5; i++) {
+            sketch.increment(1);
+        }
+        CHECK(sketch.estimate(1) == 5);
+        for (int i = 0; i < 100; i++) {
+            sketch.increment(2);
+        }
+        CHECK(sketch.estimate(2) == 15);
+
+        bool never_under = true;
+        for (uint64_t key = 100; key < 600; key++) {
+            sketch.increment(key);
+            sketch.increment(key);
+        }
+        for (uint64_t key = 100; key < 600; key++) {
+            never_under &= sketch.estimate(key) >= 2;
+        }
+        CHECK(never_under);
+    }
+
+    // After 10x the expected entries in additions, every counter is halved
+    {
+        FrequencySketch sketch(4096);
+        for (int i = 0; i < 12; i++) {
+            sketch.increment(7);
+        }
+        unsigned before = sketch.estimate(7);
+        CHECK(before >= 12);
+        for (uint64_t i = 0; i < 4096 * 11; i++) {
+            sketch.increment(1000 + i);
+        }
+        unsigned after = sketch.estimate(7);
+        CHECK(after <= before / 2 + 1);
+        CHECK(after >= 5);
+    }
+
+    // Concurrent increments of one key are not lost below the cap
+    {
+        FrequencySketch sketch(1 << 16);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 3; i++) {
+                    sketch.increment(42);
+                }
+                for (uint64_t key = 0; key < 2000; key++) {
+                    sketch.increment(1000000 * (t + 1) + key);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(sketch.estimate(42) >= 12);
+    }
+
+    // A scan of keys seen once does not push out a hot set that keeps being
+    // read while the scan runs
+    {
+        ConcurrentCache<uint64_t, uint64_t>::Options options;
+        options.policy = ConcurrentCache<uint64_t, uint64_t>::Policy::W_TINYLFU;
+        options.shards = 1;
+        ConcurrentCache<uint64_t, uint64_t> cache(1000, options);
+        uint64_t value;
+        auto read_through = [&](uint64_t key) {
+            if (!cache.get(key, value)) {
+                cache.insert(key, key);
+            }
+        };
+        for (int round = 0; round < 5; round++) {
+            for (uint64_t key = 0; key < 500; key++) {
+                read_through(key);
+            }
+        }
+        for (uint64_t i = 0; i < 100000; i++) {
+            read_through(1000000 + i);
+            read_through(i % 500);
+        }
+        size_t hot_left = 0;
+        for (uint64_t key = 0; key < 500; key++) {
+            hot_left += cache.get(key, value) ? 1 : 0;
+        }
+        CHECK(hot_left >= 450);
+        CHECK(cache.size() <= 1000);
+    }
+
+    return test_result("Frequency sketch");
+}
@@ -0,0 +1,121 @@
+#include "lockfree_hashmap.hpp"
+#include "test_check.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+// freeze(): build, write and mmap a frozen table, read it from several
+// threads, and survive a damaged tag array that has no empty slot
+int main() {
+    std::cout << "FrozenHashMap Test\n";
+    std::cout << "==================\n\n";
+
+    char directory[] = "/tmp/lfhm_frozen_test_XXXXXX";
+    if (::mkdtemp(directory) == nullptr) {
+        std::cout << "✗ cannot create a temporary directory\n";
+        return 1;
+    }
+    std::string path = std::string(directory) + "/prices.frozen";
+
+    constexpr uint64_t KEYS = 30000;
+    LockFreeHashMap<uint64_t, double> map(4096);
+    for (uint64_t key = 0; key < KEYS; key++) {
+        map.insert(key * 3, key * 0.5);
+    }
+    map.remove(0);
+
+    // The in-memory table holds exactly the live entries
+    {
+        FrozenHashMap<uint64_t, double> frozen = map.freeze();
+        CHECK(frozen.size() == KEYS - 1);
+        CHECK(frozen.slot_count() * 4 >= frozen.size() * 5);
+        bool all_match = true;
+        for (uint64_t key = 1; key < KEYS; key++) {
+            double value = 0;
+            all_match &= frozen.get(key * 3, value) && value == key * 0.5;
+        }
+        CHECK(all_match);
+        CHECK(!frozen.contains(0));
+        CHECK(!frozen.contains(1));
+        size_t visited = 0;
+        frozen.for_each([&](const uint64_t&, const double&) { visited++; });
+        CHECK(visited == KEYS - 1);
+        frozen.write(path);
+    }
+
+    // The mapped file answers the same lookups from several threads at once
+    {
+        FrozenHashMap<uint64_t, double> shared = FrozenHashMap<uint64_t, double>::open(path, true);
+        CHECK(shared.size() == KEYS - 1);
+        std::vector<std::thread> readers;
+        std::vector<int> mismatches(4, 0);
+        for (int t = 0; t < 4; t++) {
+            readers.emplace_back([&, t] {
+                for (uint64_t key = t; key < KEYS * 3; key += 4) {
+                    double value = 0;
+                    bool expected = key % 3 == 0 && key != 0;
+                    bool found = shared.get(key, value);
+                    mismatches[t] += found != expected || (found && value != key / 3 * 0.5);
+                }
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        CHECK(mismatches[0] + mismatches[1] + mismatches[2] + mismatches[3] == 0);
+    }
+
+    // Wrong types and bad headers are rejected
+    {
+        bool threw = false;
+        try {
+            FrozenHashMap<uint32_t, double>::open(path);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    // Every tag marked occupied: open() without verify_data accepts the file,
+    // and lookups of absent keys still return instead of probing forever
+    {
+        std::string bytes;
+        {
+            std::ifstream in(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        size_t slot_count = FrozenHashMap<uint64_t, double>::open(path).slot_count();
+        for (size_t i = 0; i < slot_count; i++) {
+            bytes[64 + i] = static_cast<char>(0x80 | (bytes[64 + i] & 0x7F));
+        }
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        FrozenHashMap<uint64_t, double> damaged = FrozenHashMap<uint64_t, double>::open(path);
+        double value = 0;
+        CHECK(!damaged.get(1, value));
+        CHECK(!damaged.get(KEYS * 3 + 1, value));
+
+        bool threw = false;
+        try {
+            FrozenHashMap<uint64_t, double>::open(path, true);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    std::remove(path.c_str());
+    ::rmdir(directory);
+    return test_result("FrozenHashMap");
+}
@@ -0,0 +1,185 @@
+#include "lockfree_hashmap.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// get_or_compute(): single flight, failure hand-off, and how remove(),
+// remove_shadowed() and stats() treat a placeholder whose factory is running
+using namespace std::chrono_literals;
+using Feed = MutationFeed<int, int>;
+
+int main() {
+    std::cout << "get_or_compute Test\n";
+    std::cout << "===================\n\n";
+
+    // Racing callers share one factory call
+    {
+        LockFreeHashMap<int, int> map(64);
+        std::atomic<int> calls{0};
+        std::atomic<int> wrong{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([&] {
+                for (int key = 0; key < 200; key++) {
+                    int value = map.get_or_compute(key, [&] {
+                        calls.fetch_add(1);
+                        std::this_thread::yield();
+                        return key * 3;
+                    });
+                    wrong += value != key * 3 ? 1 : 0;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(calls.load() == 200);
+        CHECK(wrong.load() == 0);
+    }
+
+    // A throwing factory hands the computation to a waiter
+    {
+        LockFreeHashMap<int, int> map(16);
+        bool threw = false;
+        try {
+            map.get_or_compute(1, []() -> int { throw std::runtime_error("factory"); });
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(map.get_or_compute(1, [] { return 5; }) == 5);
+    }
+
+    // While the factory runs the key is absent to get(), remove() and stats()
+    {
+        LockFreeHashMap<int, int> map(16);
+        Feed feed(64);
+        map.set_mutation_feed(&feed);
+        std::atomic<bool> release{false};
+        std::atomic<int> calls{0};
+        std::thread computing([&] {
+            map.get_or_compute(7, [&] {
+                calls.fetch_add(1);
+                while (!release.load()) {
+                    std::this_thread::sleep_for(1ms);
+                }
+                return 70;
+            });
+        });
+        while (map.stats().computing == 0) {
+            std::this_thread::yield();
+        }
+        int value = 0;
+        CHECK(!map.get(7, value));
+        CHECK(!map.remove(7));
+        CHECK(map.stats().live_entries == 0);
+        CHECK(map.stats().computing == 1);
+        release.store(true);
+        computing.join();
+
+        CHECK(map.get(7, value) && value == 70);
+        CHECK(map.get_or_compute(7, [&] { calls.fetch_add(1); return 0; }) == 70);
+        CHECK(calls.load() == 1);
+        CHECK(map.remove(7));
+
+        std::vector<Feed::Mutation> records;
+        feed.drain([&](const Feed::Mutation& m) { records.push_back(m); });
+        CHECK(records.size() == 2);
+        CHECK(records.size() == 2 && records[0].type == Feed::Type::INSERT && records[0].value == 70);
+        CHECK(records.size() == 2 && records[1].type == Feed::Type::REMOVE);
+    }
+
+    // remove_shadowed() waits for an older placeholder instead of leaving it live
+    {
+        LockFreeHashMap<int, int> map(16);
+        std::atomic<bool> release{false};
+        std::thread computing([&] {
+            map.get_or_compute(9, [&] {
+                while (!release.load()) {
+                    std::this_thread::sleep_for(1ms);
+                }
+                return 1;
+            });
+        });
+        while (map.stats().computing == 0) {
+            std::this_thread::yield();
+        }
+        map.insert(9, 2);
+        std::thread shadowing([&] { map.remove_shadowed(9); });
+        std::this_thread::sleep_for(5ms);
+        release.store(true);
+        computing.join();
+        shadowing.join();
+        int value = 0;
+        CHECK(map.get(9, value) && value == 2);
+        CHECK(map.remove(9));
+        CHECK(!map.get(9, value));
+    }
+
+    // Removes racing computations: a key's REMOVE never precedes its INSERT
+    {
+        LockFreeHashMap<int, int> map(64);
+        Feed feed(1 << 12);
+        map.set_mutation_feed(&feed);
+        const int KEYS = 32;
+        std::atomic<bool> done{false};
+        std::atomic<int> removed{0};
+        std::atomic<int> computed{0};
+
+        std::map<int, long> balance;
+        bool ordered = true;
+        size_t inserts = 0;
+        size_t removes = 0;
+        auto consume = [&](const Feed::Mutation& m) {
+            if (m.type == Feed::Type::INSERT) {
+                balance[m.key]++;
+                inserts++;
+            } else {
+                removes++;
+                ordered = ordered && --balance[m.key] >= 0;
+            }
+        };
+        std::thread consumer([&] {
+            while (!done.load()) {
+                if (feed.drain(consume) == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 50000; i++) {
+                    int key = (i * 7 + t) % KEYS;
+                    map.get_or_compute(key, [&] {
+                        computed.fetch_add(1);
+                        std::this_thread::yield(); // Widen the placeholder window
+                        return key;
+                    });
+                    if (i % 4 == t) {
+                        removed += map.remove(key) ? 1 : 0;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        done.store(true);
+        consumer.join();
+        feed.drain(consume);
+
+        CHECK(ordered);
+        CHECK(inserts == static_cast<size_t>(computed.load()));
+        CHECK(removes == static_cast<size_t>(removed.load()));
+        std::cout << "  " << computed.load() << " computations, " << removed.load() << " removes\n";
+    }
+
+    return test_result("get_or_compute_test");
+}
@@ -0,0 +1,92 @@
+#include "group_by.hpp"
+#include "test_check.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// merge() from racing threads, and parallel_group_by() against a std::map
+// reference with heavy hitters plus more cold keys than a pre-aggregation
+// table holds
+int main() {
+    std::cout << "Group By Test\n";
+    std::cout << "=============\n\n";
+
+    // Concurrent merges of the same keys lose no update and share one node
+    {
+        constexpr int THREADS = 8;
+        constexpr int KEYS = 64;
+        constexpr int ROUNDS = 5000;
+        LockFreeHashMap<int, int64_t> map(16);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&] {
+                for (int round = 0; round < ROUNDS; round++) {
+                    map.merge(round % KEYS, 1, [](int64_t a, int64_t b) { return a + b; });
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        int64_t total = 0;
+        size_t keys = 0;
+        map.for_each([&](const int&, const int64_t& value) {
+            total += value;
+            keys++;
+        });
+        CHECK(total == static_cast<int64_t>(THREADS) * ROUNDS);
+        CHECK(keys == KEYS);
+        auto stats = map.stats();
+        CHECK(stats.live_entries == KEYS);
+        CHECK(stats.tombstones == 0);
+    }
+
+    std::mt19937_64 rng(11);
+    std::vector<std::pair<uint64_t, int64_t>> rows;
+    for (int i = 0; i < 400000; i++) {
+        uint64_t key = i % 4 == 0 ? rng() % 8 : rng() % 50000; // 8 heavy hitters
+        rows.emplace_back(key, static_cast<int64_t>(rng() % 1000) - 500);
+    }
+
+    // Sums and maxima match a sequential reference for any worker count
+    {
+        std::map<uint64_t, int64_t> sums;
+        std::map<uint64_t, int64_t> maxima;
+        for (const auto& row : rows) {
+            sums[row.first] += row.second;
+            auto it = maxima.find(row.first);
+            maxima[row.first] = it == maxima.end() ? row.second : std::max(it->second, row.second);
+        }
+
+        for (size_t threads : {1, 4, 8}) {
+            auto result = parallel_group_by(rows, [](int64_t a, int64_t b) { return a + b; }, threads);
+            CHECK(result.partitions.size() == threads);
+            std::map<uint64_t, int64_t> got;
+            size_t duplicates = 0;
+            result.for_each([&](uint64_t key, int64_t value) {
+                duplicates += got.count(key);
+                got[key] = value;
+            });
+            CHECK(duplicates == 0);
+            CHECK(got == sums);
+        }
+
+        auto result = parallel_group_by(rows, [](int64_t a, int64_t b) { return std::max(a, b); }, 4, 60000);
+        std::map<uint64_t, int64_t> got;
+        result.for_each([&](uint64_t key, int64_t value) { got[key] = value; });
+        CHECK(got == maxima);
+    }
+
+    // No rows, no groups
+    {
+        std::vector<std::pair<uint64_t, int64_t>> none;
+        CHECK(parallel_group_by(none, [](int64_t a, int64_t b) { return a + b; }, 4).size() == 0);
+    }
+
+    return test_result("Group by");
+}
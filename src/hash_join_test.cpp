@@ -0,0 +1,68 @@
+#include "hash_join.hpp"
+#include "test_check.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// parallel_hash_join(): matches a std::multimap reference join for several
+// worker counts, with duplicate keys on both sides, skewed probes and empty
+// inputs
+using Row = std::tuple<uint64_t, int, int>;
+
+template<typename Result>
+std::vector<Row> sorted_rows(const Result& result) {
+    std::vector<Row> rows;
+    result.for_each([&](const auto& match) { rows.emplace_back(match.key, match.build, match.probe); });
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+int main() {
+    std::cout << "Hash Join Test\n";
+    std::cout << "==============\n\n";
+
+    std::mt19937_64 rng(7);
+    std::vector<std::pair<uint64_t, int>> build;
+    std::vector<std::pair<uint64_t, int>> probe;
+    for (int i = 0; i < 20000; i++) {
+        build.emplace_back(rng() % 15000, i); // Some keys repeat
+    }
+    for (int i = 0; i < 100000; i++) {
+        // Skewed: a third of the probes hit key 1, the rest spread (some miss)
+        probe.emplace_back(i % 3 == 0 ? 1 : rng() % 30000, i);
+    }
+    build.emplace_back(1, -1);
+    build.emplace_back(1, -2);
+
+    std::multimap<uint64_t, int> build_index(build.begin(), build.end());
+    std::vector<Row> expected;
+    for (const auto& row : probe) {
+        auto range = build_index.equal_range(row.first);
+        for (auto it = range.first; it != range.second; ++it) {
+            expected.emplace_back(row.first, it->second, row.second);
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+
+    // Every pairing, once, regardless of how many workers share the work
+    for (size_t threads : {1, 2, 8}) {
+        auto result = parallel_hash_join(build, probe, threads);
+        CHECK(result.partitions.size() == threads);
+        CHECK(result.size() == expected.size());
+        CHECK(sorted_rows(result) == expected);
+    }
+
+    // An empty side joins to nothing
+    {
+        std::vector<std::pair<uint64_t, int>> none;
+        CHECK(parallel_hash_join(none, probe, 4).size() == 0);
+        CHECK(parallel_hash_join(build, none, 4).size() == 0);
+    }
+
+    return test_result("Hash join");
+}
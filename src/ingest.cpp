@@ -0,0 +1,92 @@
+#include "delimited_ingest.hpp"
+#include "lockfree_hashmap.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Load the key/value columns of a CSV/TSV file into a LockFreeHashMap in
+// parallel and report the load rate
+//
+//   ingest FILE [--delimiter C|tab] [--key N] [--value N] [--threads N] [--header]
+
+[[noreturn]] static void usage() {
+    std::cerr << "usage: ingest FILE [--delimiter C|tab] [--key N] [--value N] "
+                 "[--threads N] [--header]\n";
+    std::exit(2);
+}
+
+// Value of a numeric option; anything but a whole non-negative number is a
+// usage error
+static size_t parse_count(const std::string& text) {
+    try {
+        size_t used = 0;
+        unsigned long value = std::stoul(text, &used);
+        if (used == text.size() && text[0] != '-') {
+            return value;
+        }
+    } catch (const std::logic_error&) {
+        // Not a number, or out of range
+    }
+    std::cerr << "ingest: invalid number: " << text << "\n";
+    usage();
+}
+
+int main(int argc, char** argv) {
+    std::string path;
+    IngestOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--header") {
+            options.skip_header = true;
+        } else if (arg == "--delimiter" && has_value) {
+            std::string delimiter = argv[++i];
+            if (delimiter == "tab" || delimiter == "\\t") {
+                options.delimiter = '\t';
+            } else if (delimiter.size() == 1) {
+                options.delimiter = delimiter[0];
+            } else {
+                usage();
+            }
+        } else if (arg == "--key" && has_value) {
+            options.key_column = parse_count(argv[++i]);
+        } else if (arg == "--value" && has_value) {
+            options.value_column = parse_count(argv[++i]);
+        } else if (arg == "--threads" && has_value) {
+            options.threads = parse_count(argv[++i]);
+        } else if (arg.empty() || arg[0] == '-' || !path.empty()) {
+            usage();
+        } else {
+            path = arg;
+        }
+    }
+    if (path.empty()) {
+        usage();
+    }
+
+    try {
+        MappedFile file(path);
+        LockFreeHashMap<std::string, std::string> map(estimate_row_count(file));
+
+        auto start = std::chrono::steady_clock::now();
+        IngestStats stats = ingest_delimited(file, map, options);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "File:        " << path << " (" << file.size() / (1024.0 * 1024.0) << " MiB)\n";
+        std::cout << "Threads:     " << stats.threads << "\n";
+        std::cout << "Buckets:     " << map.bucket_count() << "\n";
+        std::cout << "Rows:        " << stats.rows << " inserted, " << stats.skipped << " skipped\n";
+        std::cout << "Time:        " << seconds * 1000.0 << " ms\n";
+        std::cout << "Throughput:  " << stats.rows / seconds / 1e6 << " M rows/sec, "
+                  << file.size() / seconds / (1024.0 * 1024.0) << " MiB/sec\n";
+    } catch (const std::exception& e) {
+        std::cerr << "ingest: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
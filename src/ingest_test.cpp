@@ -0,0 +1,159 @@
+#include "delimited_ingest.hpp"
+#include "test_check.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <unistd.h>
+
+// ingest_delimited(): CRLF lines, blank lines, short rows, a header line, the
+// key and value in the same column, empty fields, rows rejected by convert(),
+// a file cut into chunks in the middle of lines, and an empty file
+
+static std::string directory;
+
+static std::string write_file(const std::string& name, const std::string& text) {
+    std::string path = directory + "/" + name;
+    std::ofstream out(path, std::ios::binary);
+    out << text;
+    return path;
+}
+
+static std::string lookup(const LockFreeHashMap<std::string, std::string>& map, const std::string& key) {
+    std::string value;
+    return map.get(key, value) ? value : "<missing>";
+}
+
+int main() {
+    std::cout << "Delimited Ingest Test\n";
+    std::cout << "=====================\n\n";
+
+    char pattern[] = "/tmp/lfhm_ingest_test_XXXXXX";
+    CHECK(::mkdtemp(pattern) != nullptr);
+    directory = pattern;
+
+    // CRLF, blank and short lines, an empty value, a final line without '\n'
+    {
+        std::string path = write_file("mixed.csv",
+            "a,1\r\n"
+            "\n"
+            "\r\n"
+            "short\n"
+            "b,2,extra\n"
+            "c,\r\n"
+            "d,4");
+        MappedFile file(path);
+        LockFreeHashMap<std::string, std::string> map(estimate_row_count(file));
+        IngestStats stats = ingest_delimited(file, map);
+        CHECK(stats.rows == 4);
+        CHECK(stats.skipped == 3);
+        CHECK(stats.threads == 1);
+        CHECK(lookup(map, "a") == "1");
+        CHECK(lookup(map, "b") == "2");
+        CHECK(lookup(map, "c").empty());
+        CHECK(lookup(map, "d") == "4");
+        CHECK(lookup(map, "short") == "<missing>");
+    }
+
+    // Header skipped, tab delimiter, value column before the key column
+    {
+        std::string path = write_file("header.tsv", "value\tkey\nx\t1\ny\t2\n");
+        MappedFile file(path);
+        LockFreeHashMap<std::string, std::string> map(16);
+        IngestOptions options;
+        options.delimiter = '\t';
+        options.key_column = 1;
+        options.value_column = 0;
+        options.skip_header = true;
+        IngestStats stats = ingest_delimited(file, map, options);
+        CHECK(stats.rows == 2 && stats.skipped == 0);
+        CHECK(lookup(map, "1") == "x");
+        CHECK(lookup(map, "key") == "<missing>");
+
+        // A file holding only a header line
+        std::string only_header = write_file("only_header.csv", "k,v");
+        MappedFile header_file(only_header);
+        options.delimiter = ',';
+        stats = ingest_delimited(header_file, map, options);
+        CHECK(stats.rows == 0 && stats.skipped == 0);
+    }
+
+    // Key and value from one column; rows convert() rejects count as skipped
+    {
+        std::string path = write_file("same.csv", "a,b\n7,x\nnot-a-number,y\n9,z\n");
+        MappedFile file(path);
+        IngestOptions options;
+        options.key_column = 0;
+        options.value_column = 0;
+        LockFreeHashMap<std::string, std::string> strings(16);
+        IngestStats stats = ingest_delimited(file, strings, options);
+        CHECK(stats.rows == 4);
+        CHECK(lookup(strings, "7") == "7");
+
+        LockFreeHashMap<int, int> numbers(16);
+        stats = ingest_delimited(file, numbers, options,
+                                 [](std::string_view key_field, std::string_view, int& key, int& value) {
+                                     if (key_field.empty() || key_field[0] < '0' || key_field[0] > '9') {
+                                         return false;
+                                     }
+                                     key = std::stoi(std::string(key_field));
+                                     value = key * 2;
+                                     return true;
+                                 });
+        CHECK(stats.rows == 2 && stats.skipped == 2);
+        int value = 0;
+        CHECK(numbers.get(9, value) && value == 18);
+    }
+
+    // Several MiB of lines of varying length: chunk bounds fall inside lines
+    // and must move to the next line start, so no row is lost or split
+    {
+        constexpr int ROWS = 200000;
+        std::string text;
+        for (int row = 0; row < ROWS; row++) {
+            text += "key" + std::to_string(row) + "," + std::string(static_cast<size_t>(row % 37), 'v') +
+                    std::to_string(row) + (row % 3 == 0 ? "\r\n" : "\n");
+        }
+        CHECK(text.size() > 4 * INGEST_MIN_CHUNK_BYTES);
+        std::string path = write_file("large.csv", text);
+        MappedFile file(path);
+        for (size_t threads : {1, 3, 8}) {
+            LockFreeHashMap<std::string, std::string> map(estimate_row_count(file));
+            IngestOptions options;
+            options.threads = threads;
+            IngestStats stats = ingest_delimited(file, map, options);
+            CHECK(stats.rows == ROWS && stats.skipped == 0);
+            CHECK(stats.threads == std::min(threads, text.size() / INGEST_MIN_CHUNK_BYTES));
+            bool intact = true;
+            for (int row = 0; row < ROWS; row += 7) {
+                intact &= lookup(map, "key" + std::to_string(row)) ==
+                          std::string(static_cast<size_t>(row % 37), 'v') + std::to_string(row);
+            }
+            CHECK(intact);
+        }
+    }
+
+    // An empty file maps to nothing
+    {
+        std::string path = write_file("empty.csv", "");
+        MappedFile file(path);
+        CHECK(file.size() == 0 && file.data() == nullptr);
+        CHECK(estimate_row_count(file) == 1);
+        LockFreeHashMap<std::string, std::string> map(estimate_row_count(file));
+        IngestOptions options;
+        options.skip_header = true;
+        IngestStats stats = ingest_delimited(file, map, options);
+        CHECK(stats.rows == 0 && stats.skipped == 0 && stats.threads == 0);
+    }
+
+    for (const char* name : {"mixed.csv", "header.tsv", "only_header.csv", "same.csv", "large.csv",
+                             "empty.csv"}) {
+        std::remove((directory + "/" + name).c_str());
+    }
+    ::rmdir(directory.c_str());
+
+    return test_result("Delimited ingest");
+}
@@ -0,0 +1,295 @@
+#include "log_histogram.hpp"
+#include "parallel.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Load generator for kv_server: each thread drives one connection with
+// pipelined batches of GET/SET requests over a fixed key space and records the
+// round trip of every batch (each request in it counts that latency)
+//
+//   kv_load [--unix PATH | --port N] [--threads N] [--pipeline N] [--keys N]
+//           [--value-size N] [--set-percent N] [--seconds N]
+
+struct LoadOptions {
+    std::string unix_path = "/tmp/lockfree_hashmap.sock";
+    int port = 0;
+    size_t threads = 4;
+    size_t pipeline = 16;
+    size_t keys = 100000;
+    size_t value_size = 64;
+    unsigned set_percent = 10;
+    double seconds = 5;
+};
+
+[[noreturn]] static void fail(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+static int connect_to(const LoadOptions& options) {
+    int fd;
+    if (options.port != 0) {
+        fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(options.port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            fail("cannot connect to 127.0.0.1:" + std::to_string(options.port));
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    } else {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, options.unix_path.c_str(), sizeof(address.sun_path) - 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            fail("cannot connect to " + options.unix_path);
+        }
+    }
+    return fd;
+}
+
+static void append_bulk(std::string& out, const std::string& text) {
+    out += '$';
+    out += std::to_string(text.size());
+    out += "\r\n";
+    out += text;
+    out += "\r\n";
+}
+
+static void append_command(std::string& out, const char* command, const std::string& key,
+                           const std::string* value) {
+    out += value != nullptr ? "*3\r\n" : "*2\r\n";
+    append_bulk(out, command);
+    append_bulk(out, key);
+    if (value != nullptr) {
+        append_bulk(out, *value);
+    }
+}
+
+static void send_all(int fd, const std::string& bytes) {
+    size_t sent = 0;
+    while (sent < bytes.size()) {
+        ssize_t n = ::write(fd, bytes.data() + sent, bytes.size() - sent);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("write");
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+// Length of the complete reply at input[pos], or 0 if more bytes are needed
+static size_t reply_length(const std::string& input, size_t pos) {
+    size_t line_end = input.find("\r\n", pos);
+    if (line_end == std::string::npos) {
+        return 0;
+    }
+    size_t header = line_end + 2 - pos;
+    if (input[pos] != '$') {
+        return header;
+    }
+    long long length = std::atoll(input.c_str() + pos + 1);
+    if (length < 0) {
+        return header;
+    }
+    size_t total = header + static_cast<size_t>(length) + 2;
+    return input.size() - pos >= total ? total : 0;
+}
+
+// Read until `count` replies have arrived. Returns the error replies seen
+static size_t receive_replies(int fd, std::string& input, size_t count) {
+    size_t pos = 0;
+    size_t errors = 0;
+    char buffer[64 * 1024];
+    while (count != 0) {
+        size_t length;
+        while (count != 0 && pos < input.size() && (length = reply_length(input, pos)) != 0) {
+            errors += input[pos] == '-' ? 1 : 0;
+            pos += length;
+            count--;
+        }
+        if (count == 0) {
+            break;
+        }
+        ssize_t got = ::read(fd, buffer, sizeof(buffer));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            throw std::runtime_error("server closed the connection");
+        }
+        input.append(buffer, static_cast<size_t>(got));
+    }
+    input.erase(0, pos);
+    return errors;
+}
+
+static std::string key_name(size_t key) {
+    return "key:" + std::to_string(key);
+}
+
+[[noreturn]] static void usage() {
+    std::cerr << "usage: kv_load [--unix PATH | --port N] [--threads N] [--pipeline N] [--keys N]\n"
+                 "               [--value-size N] [--set-percent N] [--seconds N]\n";
+    std::exit(2);
+}
+
+[[noreturn]] static void invalid_number(const std::string& text) {
+    std::cerr << "kv_load: invalid number: " << text << "\n";
+    usage();
+}
+
+// Value of a numeric option; anything but a whole number in [min, max] is a
+// usage error
+static size_t parse_count(const std::string& text, size_t min, size_t max) {
+    try {
+        size_t used = 0;
+        unsigned long long value = std::stoull(text, &used);
+        if (used == text.size() && text[0] != '-' && value >= min && value <= max) {
+            return static_cast<size_t>(value);
+        }
+    } catch (const std::logic_error&) {
+        // Not a number, or out of range
+    }
+    invalid_number(text);
+}
+
+// A positive, finite number of seconds
+static double parse_seconds(const std::string& text) {
+    try {
+        size_t used = 0;
+        double value = std::stod(text, &used);
+        if (used == text.size() && value > 0 && std::isfinite(value)) {
+            return value;
+        }
+    } catch (const std::logic_error&) {
+        // Not a number, or out of range
+    }
+    invalid_number(text);
+}
+
+int main(int argc, char** argv) {
+    LoadOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+        }
+        std::string value = argv[++i];
+        if (arg == "--unix") {
+            options.unix_path = value;
+        } else if (arg == "--port") {
+            options.port = static_cast<int>(parse_count(value, 1, 65535));
+        } else if (arg == "--threads") {
+            options.threads = parse_count(value, 1, SIZE_MAX);
+        } else if (arg == "--pipeline") {
+            options.pipeline = parse_count(value, 1, SIZE_MAX);
+        } else if (arg == "--keys") {
+            options.keys = parse_count(value, 1, SIZE_MAX);
+        } else if (arg == "--value-size") {
+            options.value_size = parse_count(value, 0, SIZE_MAX);
+        } else if (arg == "--set-percent") {
+            options.set_percent = static_cast<unsigned>(parse_count(value, 0, 100));
+        } else if (arg == "--seconds") {
+            options.seconds = parse_seconds(value);
+        } else {
+            usage();
+        }
+    }
+
+    try {
+        std::string payload(options.value_size, 'v');
+
+        // Preload every key so GETs hit
+        {
+            int fd = connect_to(options);
+            std::string batch;
+            std::string input;
+            for (size_t key = 0; key < options.keys; key += 1000) {
+                batch.clear();
+                size_t last = std::min(options.keys, key + 1000);
+                for (size_t k = key; k < last; k++) {
+                    append_command(batch, "SET", key_name(k), &payload);
+                }
+                send_all(fd, batch);
+                receive_replies(fd, input, last - key);
+            }
+            ::close(fd);
+        }
+
+        LogHistogram latency;
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> errors{0};
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(options.seconds));
+
+        run_threads(options.threads, [&](size_t worker) {
+            int fd = connect_to(options);
+            std::mt19937_64 rng(worker + 1);
+            std::uniform_int_distribution<size_t> pick_key(0, options.keys - 1);
+            std::uniform_int_distribution<unsigned> percent(0, 99);
+            std::string batch;
+            std::string input;
+            uint64_t done = 0;
+            uint64_t failed = 0;
+
+            while (std::chrono::steady_clock::now() < deadline) {
+                batch.clear();
+                for (size_t i = 0; i < options.pipeline; i++) {
+                    bool set = percent(rng) < options.set_percent;
+                    append_command(batch, set ? "SET" : "GET", key_name(pick_key(rng)),
+                                   set ? &payload : nullptr);
+                }
+                auto sent_at = std::chrono::steady_clock::now();
+                send_all(fd, batch);
+                failed += receive_replies(fd, input, options.pipeline);
+                uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - sent_at).count());
+                for (size_t i = 0; i < options.pipeline; i++) {
+                    latency.record(elapsed);
+                }
+                done += options.pipeline;
+            }
+            ::close(fd);
+            requests.fetch_add(done);
+            errors.fetch_add(failed);
+        });
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "Connections: " << options.threads << ", pipeline " << options.pipeline
+                  << ", " << options.set_percent << "% SET, " << options.value_size << " byte values\n";
+        std::cout << "Requests:    " << requests.load() << " (" << errors.load() << " errors)\n";
+        std::cout << "Throughput:  " << requests.load() / seconds / 1e3 << " K requests/sec\n";
+        std::cout << "Batch RTT:   p50 <= " << latency.percentile(0.50) / 1e3 << " us, p99 <= "
+                  << latency.percentile(0.99) / 1e3 << " us, p99.9 <= "
+                  << latency.percentile(0.999) / 1e3 << " us\n";
+    } catch (const std::exception& e) {
+        std::cerr << "kv_load: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
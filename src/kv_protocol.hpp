@@ -0,0 +1,290 @@
+#pragma once
+
+#include "lockfree_hashmap.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Connection state, RESP parsing and command execution for kv_server, apart
+// from its sockets and event loop. serve_readable() is the whole per-read
+// step: read, answer every complete command, write what the socket takes
+
+using Map = LockFreeHashMap<std::string, std::string>;
+
+constexpr size_t READ_CHUNK_BYTES = 64 * 1024;
+constexpr size_t ZERO_COPY_MIN_BYTES = 256;         // Smaller values are copied into the reply buffer
+constexpr size_t MAX_PENDING_OUTPUT = 4 << 20;      // Stop reading from a client this far behind
+constexpr size_t MAX_IOVECS = 256;
+constexpr size_t MAX_BULK_BYTES = 64 << 20;
+constexpr size_t MAX_ARGUMENTS = 1024;
+
+// Reply bytes waiting to be written: a range of the connection's own buffer
+// (external == nullptr) or of a value owned by the map
+struct Segment {
+    const char* external;
+    size_t offset;
+    size_t length;
+};
+
+struct Connection {
+    int fd;
+    std::string input;
+    size_t parsed = 0;
+    std::string output;
+    std::vector<Segment> segments;
+    size_t first_segment = 0;
+    size_t pending = 0;
+    uint32_t events = EPOLLIN;
+
+    explicit Connection(int socket) : fd(socket) {}
+
+    void append(std::string_view bytes) {
+        if (segments.size() > first_segment && segments.back().external == nullptr &&
+            segments.back().offset + segments.back().length == output.size()) {
+            segments.back().length += bytes.size();
+        } else {
+            segments.push_back({nullptr, output.size(), bytes.size()});
+        }
+        output.append(bytes.data(), bytes.size());
+        pending += bytes.size();
+    }
+
+    void append_external(const std::string& bytes) {
+        segments.push_back({bytes.data(), 0, bytes.size()});
+        pending += bytes.size();
+    }
+
+    void append_integer(char type, long long value) {
+        std::string line(1, type);
+        line += std::to_string(value);
+        line += "\r\n";
+        append(line);
+    }
+};
+
+inline bool equals_ignore_case(std::string_view text, const char* word) {
+    size_t length = std::strlen(word);
+    if (text.size() != length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (c >= 'a' && c <= 'z') {
+            c = static_cast<char>(c - 'a' + 'A');
+        }
+        if (c != word[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+enum class Parse { COMPLETE, INCOMPLETE, MALFORMED };
+
+// Parse a non-negative decimal ending in "\r\n" at input[pos]; pos moves past it
+inline Parse parse_length(const std::string& input, size_t& pos, long long& value) {
+    size_t end = input.find("\r\n", pos);
+    if (end == std::string::npos) {
+        return input.size() - pos > 32 ? Parse::MALFORMED : Parse::INCOMPLETE;
+    }
+    value = 0;
+    bool negative = pos < end && input[pos] == '-';
+    size_t first = pos + (negative ? 1 : 0);
+    if (first == end || end - first > 18) {
+        return Parse::MALFORMED;
+    }
+    for (size_t i = first; i < end; i++) {
+        if (input[i] < '0' || input[i] > '9') {
+            return Parse::MALFORMED;
+        }
+        value = value * 10 + (input[i] - '0');
+    }
+    if (negative) {
+        value = -value;
+    }
+    pos = end + 2;
+    return Parse::COMPLETE;
+}
+
+// One command starting at connection.parsed: a RESP array of bulk strings, or
+// an inline command (words separated by spaces, for telnet/nc)
+inline Parse parse_command(Connection& connection, std::vector<std::string_view>& args) {
+    const std::string& input = connection.input;
+    size_t pos = connection.parsed;
+    args.clear();
+
+    if (input[pos] != '*') {
+        size_t end = input.find('\n', pos);
+        if (end == std::string::npos) {
+            return input.size() - pos > MAX_BULK_BYTES ? Parse::MALFORMED : Parse::INCOMPLETE;
+        }
+        size_t line_end = end > pos && input[end - 1] == '\r' ? end - 1 : end;
+        size_t word = pos;
+        while (word < line_end) {
+            size_t space = input.find(' ', word);
+            size_t word_end = space == std::string::npos || space > line_end ? line_end : space;
+            if (word_end > word) {
+                args.emplace_back(input.data() + word, word_end - word);
+            }
+            word = word_end + 1;
+        }
+        connection.parsed = end + 1;
+        return Parse::COMPLETE;
+    }
+
+    pos++;
+    long long count;
+    Parse result = parse_length(input, pos, count);
+    if (result != Parse::COMPLETE) {
+        return result;
+    }
+    if (count < 0 || count > static_cast<long long>(MAX_ARGUMENTS)) {
+        return Parse::MALFORMED;
+    }
+    for (long long i = 0; i < count; i++) {
+        if (pos >= input.size()) {
+            return Parse::INCOMPLETE;
+        }
+        if (input[pos] != '$') {
+            return Parse::MALFORMED;
+        }
+        pos++;
+        long long length;
+        result = parse_length(input, pos, length);
+        if (result != Parse::COMPLETE) {
+            return result;
+        }
+        if (length < 0 || length > static_cast<long long>(MAX_BULK_BYTES)) {
+            return Parse::MALFORMED;
+        }
+        if (input.size() - pos < static_cast<size_t>(length) + 2) {
+            return Parse::INCOMPLETE;
+        }
+        args.emplace_back(input.data() + pos, static_cast<size_t>(length));
+        pos += static_cast<size_t>(length) + 2;
+    }
+    connection.parsed = pos;
+    return Parse::COMPLETE;
+}
+
+inline void execute(Map& map, Connection& connection, const std::vector<std::string_view>& args) {
+    if (args.empty()) {
+        return;
+    }
+    std::string_view command = args[0];
+
+    if (equals_ignore_case(command, "GET") && args.size() == 2) {
+        const std::string* value = map.find(std::string(args[1]));
+        if (value == nullptr) {
+            connection.append("$-1\r\n");
+            return;
+        }
+        connection.append_integer('$', static_cast<long long>(value->size()));
+        if (value->size() >= ZERO_COPY_MIN_BYTES) {
+            connection.append_external(*value);
+        } else {
+            connection.append(*value);
+        }
+        connection.append("\r\n");
+    } else if (equals_ignore_case(command, "SET") && args.size() == 3) {
+        std::string key(args[1]);
+        map.insert(key, std::string(args[2]));
+        map.remove_shadowed(key);
+        connection.append("+OK\r\n");
+    } else if (equals_ignore_case(command, "DEL") && args.size() >= 2) {
+        long long removed = 0;
+        for (size_t i = 1; i < args.size(); i++) {
+            std::string key(args[i]);
+            bool any = false;
+            while (map.remove(key)) {
+                any = true;
+            }
+            removed += any ? 1 : 0;
+        }
+        connection.append_integer(':', removed);
+    } else if (equals_ignore_case(command, "PING") && args.size() == 1) {
+        connection.append("+PONG\r\n");
+    } else {
+        connection.append("-ERR unknown command or wrong number of arguments\r\n");
+    }
+}
+
+// Write as much pending output as the socket takes. False if the peer is gone
+inline bool flush(Connection& connection) {
+    while (connection.pending != 0) {
+        iovec vectors[MAX_IOVECS];
+        size_t count = 0;
+        for (size_t i = connection.first_segment; i < connection.segments.size() && count < MAX_IOVECS; i++) {
+            const Segment& segment = connection.segments[i];
+            const char* base = segment.external != nullptr ? segment.external : connection.output.data();
+            vectors[count].iov_base = const_cast<char*>(base + segment.offset);
+            vectors[count].iov_len = segment.length;
+            count++;
+        }
+        ssize_t written = ::writev(connection.fd, vectors, static_cast<int>(count));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        size_t remaining = static_cast<size_t>(written);
+        connection.pending -= remaining;
+        while (remaining != 0) {
+            Segment& segment = connection.segments[connection.first_segment];
+            size_t taken = std::min(remaining, segment.length);
+            segment.offset += taken;
+            segment.length -= taken;
+            remaining -= taken;
+            if (segment.length == 0) {
+                connection.first_segment++;
+            }
+        }
+    }
+    connection.output.clear();
+    connection.segments.clear();
+    connection.first_segment = 0;
+    return true;
+}
+
+// Read once, answer every complete command, then write. False closes the connection
+inline bool serve_readable(Map& map, Connection& connection, std::vector<std::string_view>& args) {
+    if (connection.pending < MAX_PENDING_OUTPUT) {
+        size_t old_size = connection.input.size();
+        connection.input.resize(old_size + READ_CHUNK_BYTES);
+        ssize_t got = ::read(connection.fd, &connection.input[old_size], READ_CHUNK_BYTES);
+        connection.input.resize(old_size + (got > 0 ? static_cast<size_t>(got) : 0));
+        if (got == 0) {
+            return false;
+        }
+        if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return false;
+        }
+    }
+
+    while (connection.parsed < connection.input.size() && connection.pending < MAX_PENDING_OUTPUT) {
+        Parse result = parse_command(connection, args);
+        if (result == Parse::INCOMPLETE) {
+            break;
+        }
+        if (result == Parse::MALFORMED) {
+            connection.append("-ERR protocol error\r\n");
+            flush(connection);
+            return false;
+        }
+        execute(map, connection, args);
+    }
+    connection.input.erase(0, connection.parsed);
+    connection.parsed = 0;
+
+    return flush(connection);
+}
@@ -0,0 +1,229 @@
+#include "kv_protocol.hpp"
+#include "parallel.hpp"
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Key-value server speaking a RESP (Redis protocol) subset: GET, SET, DEL and
+// PING, served from one LockFreeHashMap<std::string, std::string>. Every
+// worker thread runs its own epoll loop and accepts from the shared listening
+// socket (EPOLLEXCLUSIVE wakes one worker per connection), so a connection
+// stays on one core. All complete commands in a read are parsed and answered
+// before one writev(), so pipelined clients get batched replies. Large GET
+// values are not copied: the reply points straight into the map node, which
+// stays alive for the map's lifetime (see LockFreeHashMap::find()).
+//
+// SET inserts a new node and logically deletes the shadowed one, so memory
+// grows with the number of writes until the server exits
+//
+//   kv_server [--unix PATH | --port N] [--threads N] [--buckets N]
+
+static std::atomic<bool> stopping{false};
+
+static void request_stop(int) {
+    stopping.store(true);
+}
+
+[[noreturn]] static void fail(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+static void update_events(int epoll_fd, Connection& connection) {
+    uint32_t events = (connection.pending < MAX_PENDING_OUTPUT ? uint32_t{EPOLLIN} : 0) |
+                      (connection.pending != 0 ? uint32_t{EPOLLOUT} : 0);
+    if (events != connection.events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.ptr = &connection;
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.events = events;
+    }
+}
+
+static void event_loop(int listener, bool tcp, Map& map) {
+    int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        fail("epoll_create1");
+    }
+    epoll_event listen_event{};
+    listen_event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    listen_event.data.ptr = nullptr;
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener, &listen_event) != 0) {
+        fail("epoll_ctl");
+    }
+
+    std::unordered_set<Connection*> connections;
+    std::vector<std::string_view> args;
+    epoll_event events[256];
+
+    auto close_connection = [&](Connection* connection) {
+        ::close(connection->fd);
+        connections.erase(connection);
+        delete connection;
+    };
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        int ready = ::epoll_wait(epoll_fd, events, 256, 100);
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.ptr == nullptr) {
+                int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    continue;
+                }
+                if (tcp) {
+                    int one = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                }
+                Connection* connection = new Connection(fd);
+                epoll_event event{};
+                event.events = connection->events;
+                event.data.ptr = connection;
+                ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+                connections.insert(connection);
+                continue;
+            }
+
+            Connection* connection = static_cast<Connection*>(events[i].data.ptr);
+            bool open = (events[i].events & (EPOLLERR | EPOLLHUP)) == 0 || (events[i].events & EPOLLIN) != 0;
+            if (open && (events[i].events & EPOLLOUT) != 0) {
+                open = flush(*connection);
+            }
+            if (open && (events[i].events & EPOLLIN) != 0) {
+                open = serve_readable(map, *connection, args);
+            } else if (open && connection->pending == 0 && connection->parsed < connection->input.size()) {
+                // Output drained: resume commands held back by backpressure
+                open = serve_readable(map, *connection, args);
+            }
+            if (open) {
+                update_events(epoll_fd, *connection);
+            } else {
+                close_connection(connection);
+            }
+        }
+    }
+
+    while (!connections.empty()) {
+        close_connection(*connections.begin());
+    }
+    ::close(epoll_fd);
+}
+
+[[noreturn]] static void usage() {
+    std::cerr << "usage: kv_server [--unix PATH | --port N] [--threads N] [--buckets N]\n";
+    std::exit(2);
+}
+
+// Value of a numeric option; anything but a whole number in [min, max] is a
+// usage error
+static size_t parse_count(const std::string& text, size_t min, size_t max) {
+    try {
+        size_t used = 0;
+        unsigned long long value = std::stoull(text, &used);
+        if (used == text.size() && text[0] != '-' && value >= min && value <= max) {
+            return static_cast<size_t>(value);
+        }
+    } catch (const std::logic_error&) {
+        // Not a number, or out of range
+    }
+    std::cerr << "kv_server: invalid number: " << text << "\n";
+    usage();
+}
+
+int main(int argc, char** argv) {
+    std::string unix_path = "/tmp/lockfree_hashmap.sock";
+    int port = 0;
+    size_t threads = 0;
+    size_t buckets = 1 << 20;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+        }
+        if (arg == "--unix") {
+            unix_path = argv[++i];
+        } else if (arg == "--port") {
+            port = static_cast<int>(parse_count(argv[++i], 1, 65535));
+        } else if (arg == "--threads") {
+            threads = parse_count(argv[++i], 0, SIZE_MAX);
+        } else if (arg == "--buckets") {
+            buckets = parse_count(argv[++i], 1, SIZE_MAX);
+        } else {
+            usage();
+        }
+    }
+    if (threads == 0) {
+        threads = default_parallelism();
+    }
+
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    try {
+        int listener;
+        bool tcp = port != 0;
+        if (tcp) {
+            listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            int one = 1;
+            ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(static_cast<uint16_t>(port));
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+                fail("cannot bind 127.0.0.1:" + std::to_string(port));
+            }
+        } else {
+            sockaddr_un address{};
+            if (unix_path.size() >= sizeof(address.sun_path)) {
+                throw std::runtime_error("socket path too long: " + unix_path);
+            }
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, unix_path.c_str(), unix_path.size() + 1);
+            ::unlink(unix_path.c_str());
+            listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+                fail("cannot bind " + unix_path);
+            }
+        }
+        if (::listen(listener, SOMAXCONN) != 0) {
+            fail("listen");
+        }
+
+        Map map(buckets);
+        std::cout << "Serving on " << (tcp ? "127.0.0.1:" + std::to_string(port) : unix_path)
+                  << " with " << threads << " threads\n";
+        run_threads(threads, [&](size_t) {
+            event_loop(listener, tcp, map);
+        });
+
+        ::close(listener);
+        if (!tcp) {
+            ::unlink(unix_path.c_str());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "kv_server: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "kv_protocol.hpp"
+#include "test_check.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+// kv_server's protocol layer over a socketpair: pipelined RESP and inline
+// commands answered in order, commands split across reads, zero-copy GET
+// replies, protocol errors closing the connection, and backpressure holding
+// commands back until the client drains its replies
+
+// Everything the client end can read right now
+static std::string drain(int fd) {
+    std::string received;
+    char buffer[65536];
+    ssize_t got;
+    while ((got = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        received.append(buffer, static_cast<size_t>(got));
+    }
+    return received;
+}
+
+static void send_text(int fd, const std::string& text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t wrote = ::write(fd, text.data() + sent, text.size() - sent);
+        if (wrote > 0) {
+            sent += static_cast<size_t>(wrote);
+        }
+    }
+}
+
+static std::string command(const std::vector<std::string>& words) {
+    std::string text = "*" + std::to_string(words.size()) + "\r\n";
+    for (const auto& word : words) {
+        text += "$" + std::to_string(word.size()) + "\r\n" + word + "\r\n";
+    }
+    return text;
+}
+
+static std::string bulk(const std::string& value) {
+    return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+}
+
+int main() {
+    std::cout << "KV Server Protocol Test\n";
+    std::cout << "=======================\n\n";
+
+    int fds[2];
+    CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+    int client = fds[0];
+    Map map(1024);
+    Connection connection(fds[1]);
+    std::vector<std::string_view> args;
+
+    // Pipelined commands, answered in order in one batch
+    {
+        std::string big(5000, 'b'); // Above ZERO_COPY_MIN_BYTES: sent from the map node
+        send_text(client, command({"SET", "a", "1"}) + command({"get", "a"}) + command({"GET", "missing"}) +
+                          command({"SET", "big", big}) + command({"GET", "big"}) +
+                          command({"DEL", "a", "missing"}) + command({"DEL", "a"}) + "PING\r\n" +
+                          "get  big\n" + command({"SET", "a"}) + command({"NOPE"}) + command({"PING"}));
+        CHECK(serve_readable(map, connection, args));
+        std::string expected = "+OK\r\n" + bulk("1") + "$-1\r\n" + "+OK\r\n" + bulk(big) + ":1\r\n" +
+                               ":0\r\n" + "+PONG\r\n" + bulk(big) +
+                               "-ERR unknown command or wrong number of arguments\r\n" +
+                               "-ERR unknown command or wrong number of arguments\r\n" + "+PONG\r\n";
+        CHECK(drain(client) == expected);
+        CHECK(connection.pending == 0 && connection.input.empty());
+    }
+
+    // A command split over several reads is answered once it is complete
+    {
+        std::string text = command({"SET", "split", "value"}) + command({"GET", "split"});
+        std::string received;
+        for (size_t i = 0; i < text.size(); i += 3) {
+            send_text(client, text.substr(i, 3));
+            CHECK(serve_readable(map, connection, args));
+            received += drain(client);
+        }
+        CHECK(received == "+OK\r\n" + bulk("value"));
+    }
+
+    // Backpressure: 1 MiB replies pile up past MAX_PENDING_OUTPUT while the
+    // client does not read; the rest wait in the input until output drains
+    {
+        constexpr int GETS = 12;
+        std::string value(1 << 20, 'v');
+        map.insert("large", value);
+        std::string requests;
+        for (int i = 0; i < GETS; i++) {
+            requests += command({"GET", "large"});
+        }
+        send_text(client, requests);
+        CHECK(serve_readable(map, connection, args));
+        CHECK(connection.pending != 0);
+        CHECK(!connection.input.empty()); // Commands held back
+
+        std::string received;
+        std::string expected_reply = bulk(value);
+        size_t expected = expected_reply.size() * GETS;
+        for (int round = 0; round < 100000 && received.size() < expected; round++) {
+            // As the event loop does on EPOLLOUT and after output drains
+            if (connection.pending != 0) {
+                CHECK(flush(connection));
+            } else if (!connection.input.empty()) {
+                CHECK(serve_readable(map, connection, args));
+            }
+            received += drain(client);
+        }
+        CHECK(received.size() == expected);
+        bool intact = true;
+        for (int i = 0; i < GETS && received.size() == expected; i++) {
+            intact &= received.compare(expected_reply.size() * i, expected_reply.size(), expected_reply) == 0;
+        }
+        CHECK(intact);
+        CHECK(connection.input.empty());
+    }
+
+    // Malformed input gets an error and closes the connection
+    {
+        send_text(client, command({"PING"}) + "*2\r\n$x\r\n");
+        CHECK(!serve_readable(map, connection, args));
+        CHECK(drain(client) == "+PONG\r\n-ERR protocol error\r\n");
+
+        Connection fresh(fds[1]);
+        send_text(client, "*1\r\n$-5\r\n");
+        CHECK(!serve_readable(map, fresh, args));
+        CHECK(drain(client) == "-ERR protocol error\r\n");
+    }
+
+    // The client hanging up closes the connection
+    ::close(client);
+    Connection last(fds[1]);
+    CHECK(!serve_readable(map, last, args));
+    ::close(fds[1]);
+
+    return test_result("KV server protocol");
+}
@@ -0,0 +1,96 @@
+#include "latency_sampler.hpp"
+#include "test_check.hpp"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// LatencySampler: exactly one in N calls is due, interval changes (including
+// re-enabling after 0) take effect on the next call, and samples from many
+// threads all land in the merged snapshot
+int main() {
+    std::cout << "Latency Sampler Test\n";
+    std::cout << "====================\n\n";
+
+    // One in N, and the first call after construction is due
+    {
+        LatencySampler<1> sampler(4);
+        int due = 0;
+        for (int i = 0; i < 400; i++) {
+            due += sampler.due() ? 1 : 0;
+        }
+        CHECK(due == 100);
+    }
+
+    // Off, then back on: the old countdown is dropped straight away
+    {
+        LatencySampler<1> sampler(1);
+        sampler.set_interval(0);
+        bool any_due = false;
+        for (int i = 0; i < 1000; i++) {
+            any_due |= sampler.due();
+        }
+        CHECK(!any_due);
+        sampler.set_interval(1);
+        CHECK(sampler.due());
+        CHECK(sampler.due());
+
+        // A shorter interval replaces a long countdown already in progress
+        sampler.set_interval(1u << 30);
+        sampler.due();
+        sampler.set_interval(2);
+        int due = 0;
+        for (int i = 0; i < 10; i++) {
+            due += sampler.due() ? 1 : 0;
+        }
+        CHECK(due == 5);
+    }
+
+    // Two samplers on one thread keep their own countdowns: turning one off
+    // or changing its interval leaves the other at its own 1 in N
+    {
+        LatencySampler<1> quiet(1);
+        LatencySampler<1> steady(3);
+        quiet.set_interval(0);
+        int quiet_due = 0;
+        int steady_due = 0;
+        for (int i = 0; i < 300; i++) {
+            quiet_due += quiet.due() ? 1 : 0;
+            steady_due += steady.due() ? 1 : 0;
+        }
+        CHECK(quiet_due == 0);
+        CHECK(steady_due == 100);
+
+        quiet.set_interval(7);
+        steady_due = 0;
+        for (int i = 0; i < 300; i++) {
+            quiet.due();
+            steady_due += steady.due() ? 1 : 0;
+        }
+        CHECK(steady_due == 100);
+    }
+
+    // Every thread samples every call; all samples are merged
+    {
+        constexpr int THREADS = 8;
+        constexpr int CALLS = 5000;
+        LatencySampler<2> sampler(1);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < CALLS; i++) {
+                    if (sampler.due()) {
+                        sampler.time(t % 2, [i] { return i; });
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(sampler.snapshot(0).count() + sampler.snapshot(1).count() ==
+              static_cast<uint64_t>(THREADS) * CALLS);
+        CHECK(sampler.snapshot(0).ns_per_tick > 0);
+    }
+
+    return test_result("Latency sampler");
+}
@@ -56,5 +56,13 @@ int main() {
         std::cout << "✗ Found " << found << " entries still present\n";
     }
 
+    // Tombstones stay in the chains until the map is destroyed
+    std::cout << "\nPhase 4: Chain statistics...\n";
+    auto stats = map.stats();
+    std::cout << "  Live entries: " << stats.live_entries << "\n";
+    std::cout << "  Tombstones: " << stats.tombstones << "\n";
+    std::cout << "  Max chain length: " << stats.max_chain_length << "\n";
+    std::cout << "  Mean chain length: " << stats.mean_chain_length << "\n";
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "metrics_exporter.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// PrometheusWriter and the map/reclaimer exporters (built with
+// LOCKFREE_HASHMAP_ENABLE_COUNTERS): exposition format, histogram
+// accumulation, label escaping, operation counts, and exports taken while
+// other threads mutate the map and retire nodes
+
+// Value of the first sample line that starts with prefix, or -1
+static double sample_value(const std::string& text, const std::string& prefix) {
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, prefix.size(), prefix) == 0 && line.size() > prefix.size() &&
+            line[prefix.size()] == ' ') {
+            return std::stod(line.substr(prefix.size() + 1));
+        }
+    }
+    return -1;
+}
+
+// Every non-comment line is "name[{labels}] value" and every family has
+// exactly one HELP and one TYPE line
+static bool well_formed(const std::string& text) {
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.rfind("# HELP ", 0) == 0 || line.rfind("# TYPE ", 0) == 0) {
+            continue;
+        }
+        size_t space = line.rfind(' ');
+        if (space == std::string::npos || space == 0 || space + 1 == line.size()) {
+            return false;
+        }
+        std::string value = line.substr(space + 1);
+        if (value != "+Inf" && value.find_first_not_of("0123456789.e+-") != std::string::npos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    std::cout << "Metrics Exporter Test\n";
+    std::cout << "=====================\n\n";
+
+    // Writer: families grouped, histograms cumulative with +Inf, labels escaped
+    {
+        PrometheusWriter writer;
+        writer.gauge("g", "A gauge", {{"map", "a"}}, 1.5);
+        writer.counter("c", "A counter", {}, 7);
+        writer.gauge("g", "A gauge", {{"map", "quote\"back\\slash\nline"}}, 2);
+        writer.histogram("h", "A histogram", {}, {1, 10}, {2, 3}, 12.5);
+        std::string text = writer.str();
+
+        CHECK(well_formed(text));
+        CHECK(text.find("# TYPE g gauge\ng{map=\"a\"} 1.5\ng{map=\"quote\\\"back\\\\slash\\nline\"} 2\n") !=
+              std::string::npos);
+        CHECK(sample_value(text, "c") == 7);
+        CHECK(sample_value(text, "h_bucket{le=\"1\"}") == 2);
+        CHECK(sample_value(text, "h_bucket{le=\"10\"}") == 5);
+        CHECK(sample_value(text, "h_bucket{le=\"+Inf\"}") == 5);
+        CHECK(sample_value(text, "h_count") == 5);
+        CHECK(sample_value(text, "h_sum") == 12.5);
+
+        bool threw = false;
+        try {
+            writer.counter("g", "A gauge", {}, 1);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        CHECK(threw);
+
+        char directory[] = "/tmp/lfhm_metrics_test_XXXXXX";
+        CHECK(::mkdtemp(directory) != nullptr);
+        std::string path = std::string(directory) + "/metrics.prom";
+        writer.write_file(path);
+        std::ifstream in(path);
+        std::string written((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        CHECK(written == text);
+        std::remove(path.c_str());
+        ::rmdir(directory);
+    }
+
+    // Map metrics: entries, tombstones and operation counters
+    {
+        LockFreeHashMap<int, int> map(256);
+        for (int i = 0; i < 1000; i++) {
+            map.insert(i, i);
+        }
+        int value;
+        for (int i = 0; i < 1500; i++) {
+            map.get(i, value);
+        }
+        for (int i = 0; i < 100; i++) {
+            map.remove(i);
+        }
+        PrometheusWriter writer;
+        export_map_metrics(writer, map, "users");
+        std::string text = writer.str();
+        CHECK(well_formed(text));
+        CHECK(sample_value(text, "lockfree_hashmap_entries{map=\"users\"}") == 900);
+        CHECK(sample_value(text, "lockfree_hashmap_tombstones{map=\"users\"}") == 100);
+        CHECK(sample_value(text, "lockfree_hashmap_buckets{map=\"users\"}") == 256);
+        CHECK(sample_value(text, "lockfree_hashmap_chain_length_count{map=\"users\"}") == 256);
+        CHECK(sample_value(text,
+            "lockfree_hashmap_operations_total{map=\"users\",op=\"get\",result=\"hit\"}") == 1000);
+        CHECK(sample_value(text,
+            "lockfree_hashmap_operations_total{map=\"users\",op=\"get\",result=\"miss\"}") == 500);
+        CHECK(sample_value(text,
+            "lockfree_hashmap_operations_total{map=\"users\",op=\"insert\",result=\"ok\"}") == 1000);
+        CHECK(sample_value(text,
+            "lockfree_hashmap_operations_total{map=\"users\",op=\"remove\",result=\"hit\"}") == 100);
+    }
+
+    // Exports taken while writers run stay well formed, the counters add up
+    // once the writers stop, and the unreclaimed gauge never wraps below zero
+    {
+        constexpr int THREADS = 4;
+        constexpr int ROUNDS = 20000;
+        LockFreeHashMap<int, int> map(1024);
+        HazardPointerManager<int> reclaimer;
+        std::atomic<int> running{THREADS};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&, t] {
+                int value;
+                for (int i = 0; i < ROUNDS; i++) {
+                    int key = t * ROUNDS + i;
+                    map.insert(key, key);
+                    map.get(key, value);
+                    reclaimer.retire(new int(i));
+                }
+                reclaimer.reclaim();
+                running.fetch_sub(1);
+            });
+        }
+
+        bool all_well_formed = true;
+        bool gauge_sane = true;
+        while (running.load() > 0) {
+            PrometheusWriter writer;
+            export_map_metrics(writer, map, "live", 8);
+            export_reclaimer_metrics(writer, reclaimer, "ints");
+            std::string text = writer.str();
+            all_well_formed &= well_formed(text);
+            double unreclaimed = sample_value(text, "hazard_pointer_unreclaimed_nodes{reclaimer=\"ints\"}");
+            gauge_sane &= unreclaimed >= 0 && unreclaimed <= THREADS * ROUNDS;
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(all_well_formed);
+        CHECK(gauge_sane);
+
+        PrometheusWriter writer;
+        export_map_metrics(writer, map, "live");
+        export_reclaimer_metrics(writer, reclaimer, "ints");
+        std::string text = writer.str();
+        CHECK(sample_value(text,
+            "lockfree_hashmap_operations_total{map=\"live\",op=\"insert\",result=\"ok\"}") ==
+              THREADS * ROUNDS);
+        CHECK(sample_value(text,
+            "lockfree_hashmap_operations_total{map=\"live\",op=\"get\",result=\"hit\"}") ==
+              THREADS * ROUNDS);
+        CHECK(sample_value(text, "hazard_pointer_retired_total{reclaimer=\"ints\"}") == THREADS * ROUNDS);
+        CHECK(sample_value(text, "hazard_pointer_unreclaimed_nodes{reclaimer=\"ints\"}") == 0);
+        CHECK(sample_value(text, "hazard_pointer_freed_total{reclaimer=\"ints\"}") == THREADS * ROUNDS);
+    }
+
+    return test_result("Metrics exporter");
+}
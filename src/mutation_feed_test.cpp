@@ -0,0 +1,190 @@
+#include "lockfree_hashmap.hpp"
+#include "test_check.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// MutationFeed: per-key order under concurrent producers and consumers,
+// idle lane reservations, a full ring, block_size 1 and publish_batch
+using Feed = MutationFeed<int, int>;
+
+int main() {
+    std::cout << "MutationFeed Test\n";
+    std::cout << "=================\n\n";
+
+    // Each key's inserts arrive in the order they were made, with sequences
+    // strictly increasing, through a small ring that keeps filling up
+    {
+        constexpr int THREADS = 4;
+        constexpr int KEYS_PER_THREAD = 16;
+        constexpr int ROUNDS = 2000;
+        LockFreeHashMap<int, int> map(256);
+        Feed feed(1 << 8);
+        map.set_mutation_feed(&feed);
+
+        std::atomic<bool> producing{true};
+        std::map<int, int> last_value;
+        size_t received = 0;
+        bool sequences_increase = true;
+        bool values_increase = true;
+        std::thread consumer([&] {
+            uint64_t last_sequence = 0;
+            bool first = true;
+            auto take = [&](const Feed::Mutation& m) {
+                sequences_increase &= first || m.sequence > last_sequence;
+                first = false;
+                last_sequence = m.sequence;
+                auto it = last_value.find(m.key);
+                values_increase &= it == last_value.end() || m.value > it->second;
+                last_value[m.key] = m.value;
+                received++;
+            };
+            while (producing.load()) {
+                if (feed.drain(take) == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            feed.drain(take);
+        });
+
+        std::vector<std::thread> producers;
+        for (int t = 0; t < THREADS; t++) {
+            producers.emplace_back([&, t] {
+                for (int round = 0; round < ROUNDS; round++) {
+                    for (int k = 0; k < KEYS_PER_THREAD; k++) {
+                        map.insert(t * KEYS_PER_THREAD + k, round);
+                    }
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        producing.store(false);
+        consumer.join();
+
+        CHECK(received == static_cast<size_t>(THREADS * KEYS_PER_THREAD * ROUNDS));
+        CHECK(sequences_increase);
+        CHECK(values_increase);
+        CHECK(last_value.size() == static_cast<size_t>(THREADS * KEYS_PER_THREAD));
+        CHECK(feed.backlog() == 0);
+    }
+
+    // A lane holding an unused reservation does not hold back the consumer
+    {
+        Feed feed(64, 16);
+        int value = 1;
+        feed.publish(Feed::Type::INSERT, 7, &value);
+        Feed::Mutation m;
+        CHECK(feed.try_pop(m));
+        CHECK(m.key == 7 && m.value == 1);
+        CHECK(!feed.try_pop(m));
+
+        // A different key lands in a fresh block after the padded rest
+        value = 2;
+        uint64_t sequence = feed.publish(Feed::Type::INSERT, 8, &value);
+        CHECK(feed.try_pop(m));
+        CHECK(m.key == 8 && m.sequence == sequence && m.sequence > 0);
+        CHECK(!feed.try_pop(m));
+    }
+
+    // block_size 1 hands out every sequence in order without gaps
+    {
+        Feed feed(16, 1);
+        for (int i = 0; i < 40; i++) {
+            feed.publish(i % 2 == 0 ? Feed::Type::INSERT : Feed::Type::REMOVE, i,
+                         i % 2 == 0 ? &i : nullptr);
+            Feed::Mutation m;
+            CHECK(feed.try_pop(m));
+            CHECK(m.sequence == static_cast<uint64_t>(i));
+            CHECK(m.key == i);
+            CHECK(m.value == (i % 2 == 0 ? i : 0));
+        }
+    }
+
+    // A batch keeps its records in order, and a later publish of one of its
+    // keys gets a larger sequence
+    {
+        Feed feed(256);
+        std::vector<std::pair<int, int>> batch;
+        for (int i = 0; i < 50; i++) {
+            batch.emplace_back(i % 5, i);
+        }
+        uint64_t first = feed.publish_batch(Feed::Type::INSERT, batch.begin(), batch.end());
+        int value = 100;
+        uint64_t later = feed.publish(Feed::Type::INSERT, 3, &value);
+        CHECK(later > first);
+
+        std::map<int, std::vector<int>> by_key;
+        std::map<int, uint64_t> last_sequence;
+        size_t received = 0;
+        uint64_t lowest = UINT64_MAX;
+        feed.drain([&](const Feed::Mutation& m) {
+            by_key[m.key].push_back(m.value);
+            last_sequence[m.key] = m.sequence;
+            lowest = std::min(lowest, m.sequence);
+            received++;
+        });
+        CHECK(received == 51);
+        CHECK(lowest == first);
+        CHECK(last_sequence[3] == later);
+        for (auto& entry : by_key) {
+            for (size_t i = 1; i < entry.second.size(); i++) {
+                CHECK(entry.second[i] > entry.second[i - 1]);
+            }
+        }
+        CHECK(by_key[3].back() == 100);
+    }
+
+    // Several consumers together receive every record exactly once
+    {
+        constexpr int PRODUCERS = 3;
+        constexpr int CONSUMERS = 3;
+        constexpr int PER_PRODUCER = 20000;
+        Feed feed(1 << 10, 8);
+        std::atomic<int> producers_left{PRODUCERS};
+        std::vector<std::vector<uint64_t>> seen(CONSUMERS);
+        std::vector<std::thread> threads;
+        for (int c = 0; c < CONSUMERS; c++) {
+            threads.emplace_back([&, c] {
+                Feed::Mutation m;
+                while (true) {
+                    if (feed.try_pop(m)) {
+                        seen[c].push_back(m.sequence);
+                    } else if (producers_left.load() == 0 && feed.backlog() == 0) {
+                        break;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (int p = 0; p < PRODUCERS; p++) {
+            threads.emplace_back([&, p] {
+                for (int i = 0; i < PER_PRODUCER; i++) {
+                    feed.publish(Feed::Type::INSERT, p * PER_PRODUCER + i, &i);
+                }
+                producers_left.fetch_sub(1);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::set<uint64_t> all;
+        size_t total = 0;
+        for (auto& sequences : seen) {
+            total += sequences.size();
+            all.insert(sequences.begin(), sequences.end());
+        }
+        CHECK(total == static_cast<size_t>(PRODUCERS * PER_PRODUCER));
+        CHECK(all.size() == total);
+    }
+
+    return test_result("MutationFeed");
+}
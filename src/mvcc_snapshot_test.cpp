@@ -0,0 +1,110 @@
+#include "lockfree_hashmap.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// snapshot() (LOCKFREE_HASHMAP_ENABLE_MVCC): a view ignores later inserts,
+// overwrites and removes, and views taken while a writer sweeps the keys
+// always show one moment of that sweep
+int main() {
+    std::cout << "MVCC Snapshot Test\n";
+    std::cout << "==================\n\n";
+
+    // Later writes are invisible to an earlier view
+    {
+        LockFreeHashMap<std::string, int> map(64);
+        map.insert("a", 1);
+        map.insert("b", 2);
+        auto before = map.snapshot();
+        map.insert("a", 10);
+        map.remove("b");
+        map.insert("c", 3);
+        auto after = map.snapshot();
+
+        int value = 0;
+        CHECK(before.get("a", value) && value == 1);
+        CHECK(before.get("b", value) && value == 2);
+        CHECK(!before.get("c", value));
+        CHECK(after.get("a", value) && value == 10);
+        CHECK(!after.get("b", value));
+        CHECK(after.get("c", value) && value == 3);
+        CHECK(after.version() > before.version());
+
+        std::map<std::string, int> seen;
+        before.for_each([&](const std::string& key, int v) { seen[key] = v; });
+        CHECK((seen == std::map<std::string, int>{{"a", 1}, {"b", 2}}));
+        seen.clear();
+        after.for_each([&](const std::string& key, int v) { seen[key] = v; });
+        CHECK((seen == std::map<std::string, int>{{"a", 10}, {"c", 3}}));
+    }
+
+    // One writer stores round r into keys 0..KEYS-1 in order, so at any moment
+    // the map holds r on a prefix of the keys and r - 1 on the rest. Every
+    // view must show exactly such a state, both through for_each() and get()
+    {
+        constexpr int KEYS = 200;
+        constexpr int ROUNDS = 300;
+        LockFreeHashMap<int, int> map(256);
+        for (int key = 0; key < KEYS; key++) {
+            map.insert(key, 0);
+        }
+
+        std::atomic<bool> writing{true};
+        std::thread writer([&] {
+            for (int round = 1; round <= ROUNDS; round++) {
+                for (int key = 0; key < KEYS; key++) {
+                    map.insert(key, round);
+                    if (key % 7 == 0) {
+                        map.remove_shadowed(key);
+                    }
+                }
+            }
+            writing.store(false);
+        });
+
+        std::atomic<int> torn{0};
+        std::atomic<int> views{0};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; t++) {
+            readers.emplace_back([&, t] {
+                while (writing.load()) {
+                    auto view = map.snapshot();
+                    std::vector<int> values(KEYS, -1);
+                    if (t == 0) {
+                        view.for_each([&](int key, int value) { values[key] = value; });
+                    } else {
+                        for (int key = 0; key < KEYS; key++) {
+                            view.get(key, values[key]);
+                        }
+                    }
+                    bool consistent = values[0] >= 0 && values[KEYS - 1] >= values[0] - 1;
+                    for (int key = 1; key < KEYS; key++) {
+                        consistent &= values[key] <= values[key - 1] && values[key] >= values[0] - 1;
+                    }
+                    torn += consistent ? 0 : 1;
+                    views++;
+                }
+            });
+        }
+        writer.join();
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        CHECK(views.load() > 0);
+        CHECK(torn.load() == 0);
+
+        auto final_view = map.snapshot();
+        bool all_final = true;
+        for (int key = 0; key < KEYS; key++) {
+            int value = -1;
+            all_final &= final_view.get(key, value) && value == ROUNDS;
+        }
+        CHECK(all_final);
+    }
+
+    return test_result("MVCC snapshot");
+}
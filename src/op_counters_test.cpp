@@ -0,0 +1,77 @@
+#include "op_counters.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// PerThreadCounters: exact totals when many more threads than slots come and
+// go over time, and when more threads than slots run at once and some of them
+// share the overflow slot
+enum class Counter { A, B, COUNT };
+
+int main() {
+    std::cout << "Op Counters Test\n";
+    std::cout << "================\n\n";
+
+    // 640 short-lived threads, 64 at a time: exited threads' slots are reused
+    {
+        constexpr int WAVES = 10;
+        constexpr int THREADS = 64;
+        constexpr int ADDS = 1000;
+        PerThreadCounters<static_cast<size_t>(Counter::COUNT)> counters;
+        bool exclusive = true;
+        for (int wave = 0; wave < WAVES; wave++) {
+            std::vector<std::thread> threads;
+            for (int t = 0; t < THREADS; t++) {
+                threads.emplace_back([&] {
+                    for (int i = 0; i < ADDS; i++) {
+                        counters.add(Counter::A, 1);
+                        counters.add(Counter::B, 2);
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+        std::thread([&] { exclusive = per_thread_counter_slot() < PER_THREAD_COUNTER_SLOTS; }).join();
+        CHECK(exclusive);
+        auto totals = counters.sum();
+        CHECK(totals[0] == static_cast<uint64_t>(WAVES) * THREADS * ADDS);
+        CHECK(totals[1] == 2 * static_cast<uint64_t>(WAVES) * THREADS * ADDS);
+    }
+
+    // More threads than slots alive at once: every slot is leased before any
+    // thread counts, so the rest share the overflow slot
+    {
+        constexpr int THREADS = static_cast<int>(PER_THREAD_COUNTER_SLOTS) + 40;
+        constexpr int ADDS = 2000;
+        PerThreadCounters<static_cast<size_t>(Counter::COUNT)> counters;
+        std::atomic<int> ready{0};
+        std::atomic<int> overflowed{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&] {
+                if (per_thread_counter_slot() == PER_THREAD_COUNTER_SLOTS) {
+                    overflowed++;
+                }
+                ready++;
+                while (ready.load() < THREADS) {
+                    std::this_thread::yield();
+                }
+                for (int i = 0; i < ADDS; i++) {
+                    counters.add(Counter::A, 1);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(overflowed.load() >= 40);
+        CHECK(counters.sum()[0] == static_cast<uint64_t>(THREADS) * ADDS);
+    }
+
+    return test_result("Op counters");
+}
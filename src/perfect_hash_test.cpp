@@ -0,0 +1,103 @@
+#include "lockfree_hashmap.hpp"
+#include "test_check.hpp"
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// build_perfect_hash() and PerfectHashMap::build(): every key found, absent
+// keys rejected, duplicates and a degenerate hash handled by the fallback
+// table, and lookups from several threads
+
+// Sends every key to the same bit, so all keys collide on every level
+struct ConstantHash {
+    size_t operator()(int) const {
+        return 42;
+    }
+};
+
+int main() {
+    std::cout << "Perfect Hash Test\n";
+    std::cout << "=================\n\n";
+
+    constexpr int KEYS = 100000;
+    LockFreeHashMap<std::string, int> map(1 << 14);
+    for (int i = 0; i < KEYS; i++) {
+        map.insert("route:" + std::to_string(i), i);
+    }
+    map.remove("route:0");
+
+    // Built in parallel from the map; the index stays near 3 bits per key
+    {
+        auto routes = map.build_perfect_hash(4);
+        CHECK(routes.size() == KEYS - 1);
+        CHECK(routes.bits_per_key() < 5.0);
+        bool all_match = true;
+        for (int i = 1; i < KEYS; i++) {
+            int value = -1;
+            all_match &= routes.get("route:" + std::to_string(i), value) && value == i;
+        }
+        CHECK(all_match);
+        int value = -1;
+        CHECK(!routes.get("route:0", value));
+        CHECK(!routes.contains("route:" + std::to_string(KEYS)));
+        CHECK(!routes.contains(""));
+
+        // Read-only after build: concurrent lookups agree
+        std::vector<int> misses(4, 0);
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; t++) {
+            readers.emplace_back([&, t] {
+                for (int i = 1 + t; i < KEYS; i += 4) {
+                    int found = -1;
+                    misses[t] += !routes.get("route:" + std::to_string(i), found) || found != i;
+                }
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        CHECK(misses[0] + misses[1] + misses[2] + misses[3] == 0);
+    }
+
+    // A larger gamma needs no more levels; one worker builds the same key set
+    {
+        auto compact = map.build_perfect_hash(1, 1.0);
+        auto roomy = map.build_perfect_hash(1, 2.0);
+        CHECK(roomy.level_count() <= compact.level_count());
+        CHECK(compact.size() == roomy.size());
+        int value = -1;
+        CHECK(roomy.get("route:77", value) && value == 77);
+    }
+
+    // Duplicate keys keep the first value; a constant hash pushes every key
+    // into the fallback table and lookups still work
+    {
+        std::vector<std::pair<int, int>> entries;
+        for (int i = 0; i < 500; i++) {
+            entries.emplace_back(i, i * 2);
+        }
+        entries.emplace_back(7, -1);
+        auto degenerate = PerfectHashMap<int, int, ConstantHash>::build(entries, 2);
+        CHECK(degenerate.size() == 500);
+        bool all_match = true;
+        for (int i = 0; i < 500; i++) {
+            int value = -1;
+            all_match &= degenerate.get(i, value) && value == i * 2;
+        }
+        CHECK(all_match);
+        CHECK(!degenerate.contains(500));
+    }
+
+    // An empty key set builds an empty index
+    {
+        auto empty = PerfectHashMap<int, int>::build({});
+        CHECK(empty.size() == 0);
+        CHECK(!empty.contains(1));
+        CHECK(empty.bits_per_key() == 0.0);
+    }
+
+    return test_result("Perfect hash");
+}
@@ -0,0 +1,165 @@
+#include "shared_hashmap.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// SharedHashMap: single-process semantics, node recycling under threaded
+// churn in a small region, writers in forked processes, and reclamation
+// after a process is killed mid-churn
+using Shared = SharedHashMap<uint64_t, uint64_t>;
+using namespace std::chrono_literals;
+
+// Insert and remove a few keys of our own over and over; the region only
+// holds a few thousand nodes, so this fails unless removed nodes are reused
+static bool churn(Shared& map, uint64_t base, int rounds) {
+    try {
+        for (int round = 0; round < rounds; round++) {
+            uint64_t key = base + round % 8;
+            map.insert(key, round);
+            uint64_t value = 0;
+            if (!map.get(key, value) || !map.remove(key)) {
+                return false;
+            }
+        }
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    std::cout << "SharedHashMap Test\n";
+    std::cout << "==================\n\n";
+
+    // Duplicates shadow older copies; remove() uncovers them
+    {
+        Shared map = Shared::create_anonymous(64, 1 << 20);
+        CHECK(map.bucket_count() == 64);
+        map.insert(1, 10);
+        map.insert(1, 11);
+        map.insert(2, 20);
+        uint64_t value = 0;
+        CHECK(map.get(1, value) && value == 11);
+        CHECK(map.remove(1));
+        CHECK(map.get(1, value) && value == 10);
+        CHECK(map.remove(1));
+        CHECK(!map.contains(1));
+        CHECK(!map.remove(1));
+        CHECK(map.get(2, value) && value == 20);
+    }
+
+    // Threads churning in a small region keep reusing retired nodes
+    {
+        Shared map = Shared::create_anonymous(64, 1 << 17);
+        std::vector<std::thread> threads;
+        std::atomic<int> failures{0};
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&, t] {
+                failures += churn(map, static_cast<uint64_t>(t) << 32, 50000) ? 0 : 1;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(failures.load() == 0);
+        CHECK(map.used_bytes() <= map.region_bytes());
+    }
+
+    // Forked writers attach through the descriptor; the parent sees their keys
+    {
+        constexpr int CHILDREN = 3;
+        constexpr uint64_t KEYS = 2000;
+        Shared map = Shared::create_anonymous(1024, 1 << 22);
+        std::vector<pid_t> children;
+        for (int c = 0; c < CHILDREN; c++) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                Shared child = Shared::attach_fd(map.descriptor());
+                for (uint64_t i = 0; i < KEYS; i++) {
+                    child.insert(c * KEYS + i, i * 2);
+                }
+                for (uint64_t i = 0; i < KEYS; i += 2) {
+                    child.remove(c * KEYS + i);
+                }
+                ::_exit(0);
+            }
+            children.push_back(pid);
+        }
+        bool children_ok = true;
+        for (pid_t pid : children) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            children_ok &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        CHECK(children_ok);
+        bool all_match = true;
+        for (int c = 0; c < CHILDREN; c++) {
+            for (uint64_t i = 0; i < KEYS; i++) {
+                uint64_t value = 0;
+                bool found = map.get(c * KEYS + i, value);
+                all_match &= i % 2 == 0 ? !found : found && value == i * 2;
+            }
+        }
+        CHECK(all_match);
+    }
+
+    // A process killed in the middle of its operations may leave a reader
+    // count behind; the survivors reset it and keep recycling nodes
+    {
+        Shared map = Shared::create_anonymous(64, 1 << 17);
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            Shared child = Shared::attach_fd(map.descriptor());
+            while (true) {
+                churn(child, uint64_t(99) << 32, 1000);
+            }
+        }
+        std::this_thread::sleep_for(50ms);
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, nullptr, 0);
+        CHECK(churn(map, 0, 100000));
+    }
+
+    // Named regions: a second handle attaches by name and shares the data
+    {
+        std::string name = "/lfhm_shared_test_" + std::to_string(::getpid());
+        Shared::unlink(name);
+        {
+            Shared created = Shared::create(name, 128, 1 << 20);
+            created.insert(5, 55);
+            bool threw = false;
+            try {
+                Shared::create(name, 128, 1 << 20);
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            CHECK(threw);
+
+            Shared attached = Shared::attach(name);
+            uint64_t value = 0;
+            CHECK(attached.get(5, value) && value == 55);
+            attached.insert(6, 66);
+            CHECK(created.get(6, value) && value == 66);
+        }
+        Shared::unlink(name);
+        bool threw = false;
+        try {
+            Shared::attach(name);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    return test_result("SharedHashMap");
+}
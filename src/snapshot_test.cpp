@@ -0,0 +1,177 @@
+#include "lockfree_hashmap.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+// save()/load(): round trips with fixed and variable-length records, saving
+// while writers run, and rejecting truncated or corrupted files
+
+template<typename Map>
+size_t live_entries(const Map& map) {
+    size_t count = 0;
+    map.for_each([&](const auto&, const auto&) { count++; });
+    return count;
+}
+
+int main() {
+    std::cout << "Snapshot Save/Load Test\n";
+    std::cout << "=======================\n\n";
+
+    char directory[] = "/tmp/lfhm_snapshot_test_XXXXXX";
+    if (::mkdtemp(directory) == nullptr) {
+        std::cout << "✗ cannot create a temporary directory\n";
+        return 1;
+    }
+    std::string int_path = std::string(directory) + "/ints.snap";
+    std::string string_path = std::string(directory) + "/strings.snap";
+
+    // Fixed-size records, saved and loaded with several worker counts
+    {
+        LockFreeHashMap<int, int> map(4096);
+        for (int i = 0; i < 50000; i++) {
+            map.insert(i, i * 7);
+        }
+        for (int i = 0; i < 50000; i += 5) {
+            map.remove(i);
+        }
+        for (size_t threads : {1, 3, 8}) {
+            map.save(int_path, threads);
+            CHECK((LockFreeHashMap<int, int>::snapshot_bucket_count(int_path) == map.bucket_count()));
+
+            LockFreeHashMap<int, int> loaded(LockFreeHashMap<int, int>::snapshot_bucket_count(int_path));
+            loaded.load(int_path, threads);
+            CHECK(live_entries(loaded) == 40000);
+            bool all_match = true;
+            for (int i = 0; i < 50000; i++) {
+                int value = 0;
+                bool found = loaded.get(i, value);
+                all_match &= i % 5 == 0 ? !found : found && value == i * 7;
+            }
+            CHECK(all_match);
+        }
+    }
+
+    // Variable-length records round-trip byte for byte
+    {
+        LockFreeHashMap<std::string, std::string> map(256);
+        map.insert("", "empty key");
+        map.insert("empty value", "");
+        for (int i = 0; i < 2000; i++) {
+            map.insert("key:" + std::to_string(i), std::string(i % 97, 'x') + std::to_string(i));
+        }
+        map.save(string_path);
+
+        LockFreeHashMap<std::string, std::string> loaded(256);
+        loaded.load(string_path);
+        CHECK(live_entries(loaded) == 2002);
+        std::string value;
+        CHECK(loaded.get("", value) && value == "empty key");
+        CHECK(loaded.get("empty value", value) && value.empty());
+        bool all_match = true;
+        for (int i = 0; i < 2000; i++) {
+            all_match &= loaded.get("key:" + std::to_string(i), value) &&
+                         value == std::string(i % 97, 'x') + std::to_string(i);
+        }
+        CHECK(all_match);
+    }
+
+    // Saving while writers run: keys that are never touched must all be in the
+    // snapshot, and every loaded value must be one some writer stored
+    {
+        constexpr int STABLE = 20000;
+        LockFreeHashMap<int, int> map(8192);
+        for (int i = 0; i < STABLE; i++) {
+            map.insert(i, i);
+        }
+        std::atomic<int> writers_left{4};
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; t++) {
+            writers.emplace_back([&, t] {
+                for (int round = 0; round < 5000; round++) {
+                    int key = STABLE + t * 1000 + round % 1000;
+                    map.insert(key, key);
+                    if (round % 3 == 0) {
+                        map.remove(key);
+                    }
+                }
+                writers_left.fetch_sub(1);
+            });
+        }
+        for (int pass = 0; pass < 3 || writers_left.load() > 0; pass++) {
+            map.save(int_path, 4);
+            LockFreeHashMap<int, int> loaded(8192);
+            loaded.load(int_path, 4);
+            bool stable_present = true;
+            for (int i = 0; i < STABLE; i++) {
+                int value = -1;
+                stable_present &= loaded.get(i, value) && value == i;
+            }
+            CHECK(stable_present);
+            bool values_valid = true;
+            loaded.for_each([&](const int& key, const int& value) { values_valid &= key == value; });
+            CHECK(values_valid);
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+    }
+
+    // A missing, truncated or corrupted snapshot throws instead of loading
+    {
+        LockFreeHashMap<int, int> map(64);
+        for (int i = 0; i < 1000; i++) {
+            map.insert(i, i);
+        }
+        map.save(int_path);
+        std::string bytes;
+        {
+            std::ifstream in(int_path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        CHECK(bytes.size() > 128);
+
+        auto rejects = [&](const std::string& contents) {
+            {
+                std::ofstream out(int_path, std::ios::binary | std::ios::trunc);
+                out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+            }
+            LockFreeHashMap<int, int> loaded(64);
+            try {
+                loaded.load(int_path);
+            } catch (const std::runtime_error&) {
+                return true;
+            }
+            return false;
+        };
+        CHECK(rejects(bytes.substr(0, bytes.size() / 2)));
+        std::string flipped = bytes;
+        flipped[100] ^= 0x10;
+        CHECK(rejects(flipped));
+        std::string bad_header = bytes;
+        bad_header[0] ^= 0x01;
+        CHECK(rejects(bad_header));
+
+        LockFreeHashMap<int, int> loaded(64);
+        bool threw = false;
+        try {
+            loaded.load(std::string(directory) + "/missing.snap");
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    std::remove(int_path.c_str());
+    std::remove(string_path.c_str());
+    ::rmdir(directory);
+    return test_result("Snapshot save/load");
+}
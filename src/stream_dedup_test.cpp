@@ -0,0 +1,100 @@
+#include "stream_dedup.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// StreamDeduplicator: window semantics, single-flight first occurrence, and
+// lookups racing explicit and count-based rotations (run under ASan/TSan to
+// catch a generation freed while a reader still holds it)
+int main() {
+    std::cout << "Stream Deduplicator Test\n";
+    std::cout << "========================\n\n";
+
+    // Window: a key is remembered for generations - 1 rotations
+    {
+        StreamDeduplicator<int>::Options options;
+        options.generations = 3;
+        options.keys_per_generation = 0;
+        options.buckets_per_generation = 64;
+        StreamDeduplicator<int> dedup(options);
+        CHECK(!dedup.seen_before(7));
+        CHECK(dedup.seen_before(7));
+        dedup.rotate();
+        CHECK(dedup.seen_before(7));
+        dedup.rotate();
+        CHECK(dedup.seen_before(7));
+        dedup.rotate();
+        CHECK(!dedup.seen_before(7));
+        CHECK(dedup.rotations() == 3);
+    }
+
+    // Without rotation exactly one of many racing callers sees a new key
+    {
+        StreamDeduplicator<int>::Options options;
+        options.keys_per_generation = 0;
+        options.buckets_per_generation = 1024;
+        StreamDeduplicator<int> dedup(options);
+        const int THREADS = 8;
+        const int KEYS = 5000;
+        std::atomic<int> first_seen{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&] {
+                int local = 0;
+                for (int key = 0; key < KEYS; key++) {
+                    local += dedup.seen_before(key) ? 0 : 1;
+                }
+                first_seen.fetch_add(local);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(first_seen.load() == KEYS);
+    }
+
+    // Lookups racing rotations: a key's first occurrence is never a duplicate
+    {
+        StreamDeduplicator<int>::Options options;
+        options.generations = 2;
+        options.keys_per_generation = 512;
+        options.buckets_per_generation = 128;
+        StreamDeduplicator<int> dedup(options);
+        const int THREADS = 6;
+        const int KEYS = 40000;
+        std::atomic<bool> done{false};
+        std::atomic<int> false_duplicates{0};
+
+        std::thread rotator([&] {
+            while (!done.load()) {
+                dedup.rotate();
+                std::this_thread::yield();
+            }
+        });
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < KEYS; i++) {
+                    int key = t * KEYS + i;
+                    if (dedup.seen_before(key)) {
+                        false_duplicates.fetch_add(1);
+                    }
+                    dedup.seen_before(key);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        done.store(true);
+        rotator.join();
+        CHECK(false_duplicates.load() == 0);
+        CHECK(dedup.rotations() > 0);
+        std::cout << "  " << dedup.rotations() << " rotations during "
+                  << THREADS * KEYS * 2 << " lookups\n";
+    }
+
+    return test_result("stream_dedup_test");
+}
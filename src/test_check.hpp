@@ -0,0 +1,29 @@
+#pragma once
+
+#include <iostream>
+
+// Assertions for the feature test executables: CHECK reports the failing
+// expression with its location and keeps going, test_result() turns the
+// failure count into the exit code ctest looks at
+
+inline int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                            \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            std::cout << "✗ " << __FILE__ << ":" << __LINE__ << ": " #condition "\n"; \
+            test_failures()++;                                                      \
+        }                                                                           \
+    } while (0)
+
+inline int test_result(const char* name) {
+    if (test_failures() == 0) {
+        std::cout << "✓ " << name << " passed\n";
+        return 0;
+    }
+    std::cout << "✗ " << name << ": " << test_failures() << " check(s) failed\n";
+    return 1;
+}
@@ -0,0 +1,124 @@
+#include "ttl_hashmap.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// TtlHashMap: exact expiry on reads, timer-driven deletion, and physical
+// reclamation of expired and overwritten nodes while readers and writers run
+using namespace std::chrono_literals;
+
+int main() {
+    std::cout << "TTL HashMap Test\n";
+    std::cout << "================\n\n";
+
+    TtlHashMap<int, int>::Options manual;
+    manual.tick = 1ms;
+    manual.background_expiry = false;
+
+    // Expiry is exact on reads; expire() deletes and frees
+    {
+        TtlHashMap<int, int> map(64, manual);
+        map.insert(1, 10, 20ms);
+        map.insert(2, 20, 10s);
+        int value = 0;
+        CHECK(map.get(1, value) && value == 10);
+        std::this_thread::sleep_for(30ms);
+        CHECK(!map.get(1, value));
+        CHECK(map.get(2, value) && value == 20);
+        CHECK(map.expire() == 1);
+        CHECK(map.reclaimed_count() == 1);
+        CHECK(map.underlying().stats().tombstones == 0);
+
+        // Overwrites leave tombstones that the next timer reclaims
+        for (int i = 0; i < 100; i++) {
+            map.insert(3, i, 1ms);
+        }
+        std::this_thread::sleep_for(5ms);
+        map.expire();
+        CHECK(!map.get(3, value));
+        CHECK(map.underlying().stats().tombstones == 0);
+        CHECK(map.underlying().stats().live_entries == 1);
+    }
+
+    // Steady churn: chains stay short while expire() frees concurrently
+    {
+        TtlHashMap<int, int> map(256, manual);
+        const int WRITERS = 4;
+        const int READERS = 2;
+        const int KEYS = 512;
+        std::atomic<bool> done{false};
+        std::atomic<int> bad_reads{0};
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < WRITERS; t++) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng(t);
+                for (int i = 0; i < 100000; i++) {
+                    int key = static_cast<int>(rng() % KEYS);
+                    map.insert(key, key, 2ms);
+                    if (i % 7 == 0) {
+                        map.remove(key);
+                    }
+                }
+            });
+        }
+        for (int t = 0; t < READERS; t++) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng(100 + t);
+                int value = 0;
+                while (!done.load()) {
+                    int key = static_cast<int>(rng() % KEYS);
+                    if (map.get(key, value) && value != key) {
+                        bad_reads.fetch_add(1);
+                    }
+                }
+            });
+        }
+        std::thread expirer([&] {
+            while (!done.load()) {
+                map.expire();
+                std::this_thread::sleep_for(1ms);
+            }
+        });
+        for (int t = 0; t < WRITERS; t++) {
+            threads[t].join();
+        }
+        done.store(true);
+        for (int t = WRITERS; t < WRITERS + READERS; t++) {
+            threads[t].join();
+        }
+        expirer.join();
+
+        std::this_thread::sleep_for(10ms);
+        map.expire();
+        auto stats = map.underlying().stats();
+        CHECK(bad_reads.load() == 0);
+        CHECK(stats.live_entries == 0);
+        CHECK(stats.tombstones == 0);
+        CHECK(map.pending_timers() == 0);
+        CHECK(map.reclaimed_count() >= static_cast<uint64_t>(WRITERS * 100000));
+        std::cout << "  " << map.reclaimed_count() << " nodes reclaimed, "
+                  << map.expired_count() << " entries expired\n";
+    }
+
+    // Background expiry keeps running until destruction
+    {
+        TtlHashMap<int, int>::Options background;
+        background.tick = 1ms;
+        TtlHashMap<int, int> map(64, background);
+        for (int i = 0; i < 1000; i++) {
+            map.insert(i, i, 1ms);
+        }
+        auto deadline = std::chrono::steady_clock::now() + 2s;
+        while (map.reclaimed_count() < 1000 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        CHECK(map.reclaimed_count() == 1000);
+    }
+
+    return test_result("ttl_hashmap_test");
+}
@@ -0,0 +1,58 @@
+#include "hazard_pointer.hpp"
+#include "lockfree_hashmap.hpp"
+#include "test_check.hpp"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Built with LOCKFREE_HASHMAP_ENABLE_USDT and _COUNTERS: every probe site is
+// instantiated and passed through with no tracer attached, and the map and
+// reclaimer behave as without probes. The usdt_notes test then reads this
+// binary's .note.stapsdt entries (scripts/check_usdt_notes.cmake)
+int main() {
+    std::cout << "USDT Probes Test\n";
+    std::cout << "================\n\n";
+
+#ifdef LFHM_USDT_ACTIVE
+    std::cout << "Probes compiled in\n";
+#else
+    std::cout << "Probes not supported on this target; checking behaviour only\n";
+#endif
+
+    // One bucket: every walk passes the long_chain threshold, and racing
+    // inserters retry their CAS
+    constexpr int THREADS = 4;
+    constexpr int KEYS = 500;
+    LockFreeHashMap<int, int> map(1);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&map, t] {
+            for (int key = t; key < KEYS; key += THREADS) {
+                map.insert(key, key * 3);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    bool all_found = true;
+    for (int key = 0; key < KEYS; key++) {
+        int value = 0;
+        all_found &= map.get(key, value) && value == key * 3;
+    }
+    CHECK(all_found);
+    CHECK(map.remove(KEYS - 1));
+    int value = 0;
+    CHECK(!map.get(KEYS - 1, value));
+
+    // Reclaim passes fire reclaim_start and reclaim_end
+    HazardPointerManager<int> reclaimer;
+    for (int i = 0; i < 1000; i++) {
+        reclaimer.retire(new int(i));
+    }
+    reclaimer.reclaim();
+    auto counters = reclaimer.reclaim_counters();
+    CHECK(counters.retires == 1000 && counters.reclaim_freed == 1000);
+
+    return test_result("USDT probes");
+}
@@ -0,0 +1,217 @@
+#include "lockfree_hashmap.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// WorkStealingDeque and WorkStealingPool: every pushed item taken exactly once
+// while thieves race the owner, every index of run() executed exactly once
+// (from outside, from several threads at once, and nested inside tasks),
+// exceptions reaching the caller after the whole group finished, Scope and
+// current() selecting the pool, and large map teardown on a pool
+int main() {
+    std::cout << "Work-Stealing Pool Test\n";
+    std::cout << "=======================\n\n";
+
+    // Owner pushes and pops while thieves steal; a tiny initial ring makes
+    // the deque grow under contention
+    {
+        constexpr int ITEMS = 200000;
+        constexpr int THIEVES = 4;
+        WorkStealingDeque<int> deque(2);
+        std::vector<int> items(ITEMS);
+        std::unique_ptr<std::atomic<int>[]> taken(new std::atomic<int>[ITEMS]);
+        for (int i = 0; i < ITEMS; i++) {
+            items[i] = i;
+            taken[i].store(0);
+        }
+        std::atomic<bool> owner_done{false};
+        std::vector<std::thread> thieves;
+        for (int t = 0; t < THIEVES; t++) {
+            thieves.emplace_back([&] {
+                while (true) {
+                    int* item = deque.steal();
+                    if (item != nullptr) {
+                        taken[*item]++;
+                    } else if (owner_done.load()) {
+                        return;
+                    }
+                }
+            });
+        }
+        for (int i = 0; i < ITEMS; i++) {
+            deque.push(&items[i]);
+            if (i % 3 == 0) {
+                if (int* item = deque.pop()) {
+                    taken[*item]++;
+                }
+            }
+        }
+        while (int* item = deque.pop()) {
+            taken[*item]++;
+        }
+        owner_done.store(true);
+        for (auto& thief : thieves) {
+            thief.join();
+        }
+        bool exactly_once = true;
+        for (int i = 0; i < ITEMS; i++) {
+            exactly_once &= taken[i].load() == 1;
+        }
+        CHECK(exactly_once);
+        CHECK(deque.pop() == nullptr && deque.steal() == nullptr);
+    }
+
+    // Every index runs exactly once, for pools with and without workers
+    for (size_t threads : {0, 1, 4}) {
+        WorkStealingPool pool(threads);
+        CHECK(pool.thread_count() == threads);
+        for (size_t count : {0, 1, 2, 1000}) {
+            std::vector<std::atomic<int>> runs(count);
+            pool.run(count, [&](size_t i) { runs[i]++; });
+            bool exactly_once = true;
+            for (auto& r : runs) {
+                exactly_once &= r.load() == 1;
+            }
+            CHECK(exactly_once);
+        }
+    }
+
+    // Several outside threads share a pool, and every task forks nested
+    // groups two levels deep; with few workers the callers must help
+    {
+        constexpr int CALLERS = 4;
+        constexpr size_t OUTER = 16;
+        constexpr size_t MIDDLE = 8;
+        constexpr size_t INNER = 32;
+        WorkStealingPool pool(3);
+        std::atomic<uint64_t> leaves{0};
+        std::atomic<int> outside_pool{0};
+        std::vector<std::thread> callers;
+        for (int c = 0; c < CALLERS; c++) {
+            callers.emplace_back([&] {
+                pool.run(OUTER, [&](size_t) {
+                    pool.run(MIDDLE, [&](size_t) {
+                        pool.run(INNER, [&](size_t) {
+                            leaves++;
+                        });
+                    });
+                });
+                if (WorkStealingPool::current() != nullptr) {
+                    outside_pool++;
+                }
+            });
+        }
+        for (auto& caller : callers) {
+            caller.join();
+        }
+        CHECK(leaves.load() == CALLERS * OUTER * MIDDLE * INNER);
+        CHECK(outside_pool.load() == 0);
+    }
+
+    // A throwing task: the first exception reaches the caller only after the
+    // rest of its group ran, from both top-level and nested run() calls
+    {
+        WorkStealingPool pool(4);
+        std::atomic<int> ran{0};
+        bool threw = false;
+        try {
+            pool.run(500, [&](size_t i) {
+                ran++;
+                if (i % 50 == 7) {
+                    throw std::runtime_error("task failed");
+                }
+            });
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(ran.load() == 500);
+
+        std::atomic<int> nested_caught{0};
+        pool.run(8, [&](size_t) {
+            try {
+                pool.run(20, [&](size_t i) {
+                    if (i == 19) {
+                        throw std::logic_error("inner failed");
+                    }
+                });
+            } catch (const std::logic_error&) {
+                nested_caught++;
+            }
+        });
+        CHECK(nested_caught.load() == 8);
+
+        // The pool still works afterwards
+        std::atomic<int> after{0};
+        pool.run(100, [&](size_t) { after++; });
+        CHECK(after.load() == 100);
+    }
+
+    // run_parallel(): exceptions propagate, Scope picks the pool and nests,
+    // workers report their own pool as current()
+    {
+        WorkStealingPool first(2);
+        WorkStealingPool second(2);
+        CHECK(WorkStealingPool::current() == nullptr);
+
+        bool threw = false;
+        try {
+            run_parallel(4, [](size_t i) {
+                if (i == 3) {
+                    throw std::runtime_error("worker failed");
+                }
+            }, &first);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+
+        std::atomic<int> wrong_pool{0};
+        {
+            WorkStealingPool::Scope scope(first);
+            CHECK(WorkStealingPool::current() == &first);
+            run_parallel(64, [&](size_t) {
+                if (WorkStealingPool::current() != &first) {
+                    wrong_pool++;
+                }
+            });
+            {
+                WorkStealingPool::Scope inner(second);
+                CHECK(WorkStealingPool::current() == &second);
+                run_parallel(64, [&](size_t) {
+                    if (WorkStealingPool::current() != &second) {
+                        wrong_pool++;
+                    }
+                });
+            }
+            CHECK(WorkStealingPool::current() == &first);
+        }
+        CHECK(WorkStealingPool::current() == nullptr);
+        CHECK(wrong_pool.load() == 0);
+    }
+
+    // Large maps tear down on the pool, including from inside a pool task
+    {
+        WorkStealingPool pool(3);
+        WorkStealingPool::Scope scope(pool);
+        run_parallel(2, [](size_t task) {
+            LockFreeHashMap<int, int> map(1 << 20);
+            for (int i = 0; i < 100000; i++) {
+                map.insert(i, static_cast<int>(task));
+            }
+        });
+        auto map = std::make_unique<LockFreeHashMap<int, int>>(1 << 20);
+        for (int i = 0; i < 100000; i++) {
+            map->insert(i, i);
+        }
+        map.reset();
+        CHECK(map == nullptr);
+    }
+
+    return test_result("Work-stealing pool");
+}
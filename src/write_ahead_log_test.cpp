@@ -0,0 +1,121 @@
+#include "write_ahead_log.hpp"
+#include "test_check.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// DurableHashMap: concurrent logged writes, checkpoint, close and recovery,
+// and recovery after a process dies without flushing its ASYNC tail
+using Durable = DurableHashMap<int, int>;
+
+int main() {
+    std::cout << "Write-Ahead Log Test\n";
+    std::cout << "====================\n\n";
+
+    char directory[] = "/tmp/lfhm_wal_test_XXXXXX";
+    if (::mkdtemp(directory) == nullptr) {
+        std::cout << "✗ cannot create a temporary directory\n";
+        return 1;
+    }
+    std::string log_path = std::string(directory) + "/map.wal";
+    std::string snapshot_path = std::string(directory) + "/map.snap";
+
+    const int THREADS = 4;
+    const int KEYS_PER_THREAD = 5000;
+
+    // Write from several threads with a checkpoint in the middle, then close
+    {
+        LockFreeHashMap<int, int> map(1024);
+        Durable durable(map, log_path, snapshot_path);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < KEYS_PER_THREAD; i++) {
+                    int key = t * KEYS_PER_THREAD + i;
+                    durable.insert(key, key);
+                    if (i == KEYS_PER_THREAD / 2 && t == 0) {
+                        durable.checkpoint();
+                    }
+                }
+                // Overwrite evens, remove multiples of 3
+                for (int i = 0; i < KEYS_PER_THREAD; i++) {
+                    int key = t * KEYS_PER_THREAD + i;
+                    if (key % 2 == 0) {
+                        durable.insert(key, -key);
+                    }
+                    if (key % 3 == 0) {
+                        durable.remove(key);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(durable.insert(-1, 42, Durable::Durability::SYNC));
+    }
+
+    auto expected = [](int key, int& value) {
+        if (key % 3 == 0) {
+            return false;
+        }
+        value = key % 2 == 0 ? -key : key;
+        return true;
+    };
+
+    // Reopen: snapshot plus log replay must reproduce the final state
+    {
+        LockFreeHashMap<int, int> map(1024);
+        Durable durable(map, log_path, snapshot_path);
+        int wrong = 0;
+        for (int key = 0; key < THREADS * KEYS_PER_THREAD; key++) {
+            int want = 0;
+            int got = 0;
+            bool present = map.get(key, got);
+            if (present != expected(key, want) || (present && got != want)) {
+                wrong++;
+            }
+        }
+        CHECK(wrong == 0);
+        int value = 0;
+        CHECK(map.get(-1, value) && value == 42);
+    }
+
+    // A process that dies after SYNC writes keeps them; nothing else is needed
+    pid_t child = ::fork();
+    if (child == 0) {
+        LockFreeHashMap<int, int> map(1024);
+        Durable durable(map, log_path, snapshot_path);
+        for (int key = 0; key < 100; key++) {
+            durable.insert(1000000 + key, key, Durable::Durability::SYNC);
+        }
+        durable.remove(-1, Durable::Durability::SYNC);
+        ::_exit(0);  // No destructor: nothing beyond the SYNC commits is flushed
+    }
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    {
+        LockFreeHashMap<int, int> map(1024);
+        Durable durable(map, log_path, snapshot_path);
+        int recovered = 0;
+        int value = 0;
+        for (int key = 0; key < 100; key++) {
+            recovered += map.get(1000000 + key, value) && value == key ? 1 : 0;
+        }
+        CHECK(recovered == 100);
+        CHECK(!map.get(-1, value));
+        CHECK(map.get(1, value) && value == 1);
+    }
+
+    std::string cleanup = std::string("rm -rf ") + directory;
+    if (std::system(cleanup.c_str()) != 0) {
+        std::cout << "  (could not remove " << directory << ")\n";
+    }
+    return test_result("write_ahead_log_test");
+}